@@ -0,0 +1,641 @@
+#include "ColorDifference.h"
+#include "ColorLut3D.h"
+#include "ColorTransform.h"
+#include "CommonProfiles.h"
+#include "ConversionKernels.h"
+#include "ConversionTypes.h"
+#include "ImageSpaceConverter.h"
+#include "ReferenceConverter.h"
+#include "StreamingConverter.h"
+#include "ThreadPool.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace
+{
+std::atomic<qint64> allocationCount{0};
+std::atomic<qint64> allocatedBytes{0};
+} // namespace
+
+#if defined(__GLIBC__)
+// QImage buffers come from malloc rather than operator new, so count at the malloc level.
+// glibc lets the executable interpose these and still reach the real allocator.
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+
+    void *malloc(size_t size)
+    {
+        ++allocationCount;
+        allocatedBytes += static_cast<qint64>(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        ++allocationCount;
+        allocatedBytes += static_cast<qint64>(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size)
+    {
+        ++allocationCount;
+        allocatedBytes += static_cast<qint64>(size);
+        return __libc_realloc(pointer, size);
+    }
+}
+#endif
+
+namespace
+{
+struct Measurement
+{
+    QString image;
+    QString format;
+    QString operation;
+    qint64 pixels;
+    double seconds; // Fastest of all iterations
+    qint64 allocations;
+    qint64 allocatedBytes;
+};
+
+template <typename Operation>
+Measurement measure(
+    const QString &image, const QString &format, const QString &operation, qint64 pixels, int iterations,
+    Operation &&run
+)
+{
+    Measurement measurement{image, format, operation, pixels, std::numeric_limits<double>::max(), 0, 0};
+    for (int i = 0; i < iterations; ++i)
+    {
+        const qint64 countBefore = allocationCount;
+        const qint64 bytesBefore = allocatedBytes;
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        measurement.seconds        = std::min(measurement.seconds, timer.nsecsElapsed() / 1e9);
+        measurement.allocations    = allocationCount - countBefore;
+        measurement.allocatedBytes = allocatedBytes - bytesBefore;
+    }
+    return measurement;
+}
+
+// Covers the whole RGB cube: red and green follow the position, blue varies per pixel
+QImage syntheticImage(int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y)
+    {
+        QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x)
+        {
+            row[x] = qRgb(x * 255 / std::max(1, width - 1), y * 255 / std::max(1, height - 1), (x ^ y) & 0xff);
+        }
+    }
+    return image;
+}
+
+// The six faces of the RGB cube in steps of 5, where conversions between gamuts clip and masks flip
+QImage gamutEdgeImage()
+{
+    static constexpr int Steps = 52;
+    QImage image(Steps, 6 * Steps, QImage::Format_RGB32);
+    for (int face = 0; face < 6; ++face)
+    {
+        for (int a = 0; a < Steps; ++a)
+        {
+            QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(face * Steps + a));
+            for (int b = 0; b < Steps; ++b)
+            {
+                int channels[3];
+                channels[face / 2]           = face % 2 == 0 ? 0 : 255;
+                channels[(face / 2 + 1) % 3] = a * 5;
+                channels[(face / 2 + 2) % 3] = b * 5;
+                row[b]                       = qRgb(channels[0], channels[1], channels[2]);
+            }
+        }
+    }
+    return image;
+}
+
+const ColorProfileSettings *findProfile(const QString &name)
+{
+    for (int i = 0; i < CommonProfiles::profilesCount - 1; ++i)
+    {
+        if (name.compare(CommonProfiles::profiles[i].name, Qt::CaseInsensitive) == 0)
+        {
+            return &CommonProfiles::profiles[i].profile;
+        }
+    }
+    return nullptr;
+}
+
+bool parseInstructionSet(const QString &name, ConversionKernels::InstructionSet &instructionSet)
+{
+    for (auto candidate :
+         {ConversionKernels::InstructionSet::Scalar, ConversionKernels::InstructionSet::SSE41,
+          ConversionKernels::InstructionSet::AVX2, ConversionKernels::InstructionSet::AVX512})
+    {
+        if (name.compare(ConversionKernels::name(candidate), Qt::CaseInsensitive) == 0)
+        {
+            instructionSet = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+struct VerificationInput
+{
+    QString name;
+    QImage image;
+};
+
+enum class VerificationMode
+{
+    Reference,   // Compare against ReferenceConverter, computed on the spot
+    WriteGolden, // Store ReferenceConverter output as golden images
+    CheckGolden  // Compare against previously stored golden images
+};
+
+// Runs every intent for every pair of built-in profiles on every input; returns the number of failed comparisons
+int verify(
+    const std::vector<VerificationInput> &inputs, VerificationMode mode, const QDir &goldenDirectory,
+    const std::vector<ConversionKernels::InstructionSet> &instructionSets,
+    const std::vector<ComparisonTolerance> &tolerances, const ConversionOptions &options
+)
+{
+    auto fileKey = [](const char *name)
+    {
+        return QString(name).remove(' ');
+    };
+
+    int comparisons = 0;
+    int failures    = 0;
+    ComparisonResult worst;
+    // The last entry is the empty "Custom" placeholder
+    for (int source = 0; source < CommonProfiles::profilesCount - 1; ++source)
+    {
+        for (int target = 0; target < CommonProfiles::profilesCount - 1; ++target)
+        {
+            const auto &sourceInfo = CommonProfiles::profiles[source];
+            const auto &targetInfo = CommonProfiles::profiles[target];
+            const ColorDifference difference(targetInfo.profile);
+
+            for (int typeIndex = 0; typeIndex < ConversionTypes::typesCount; ++typeIndex)
+            {
+                const auto &type                     = ConversionTypes::types[typeIndex];
+                const ComparisonTolerance &tolerance = tolerances[typeIndex];
+                for (const VerificationInput &input : inputs)
+                {
+                    const QString baseName = QString("%1_%2_%3_%4").arg(
+                        input.name, fileKey(sourceInfo.name), fileKey(targetInfo.name), QString(type.key)
+                    );
+                    const QString imagePath = goldenDirectory.filePath(baseName + ".png");
+                    const QString maskPath  = goldenDirectory.filePath(baseName + "_mask.png");
+
+                    ConversionOutput expected;
+                    if (mode == VerificationMode::CheckGolden)
+                    {
+                        expected = {QImage(imagePath), QImage(maskPath)};
+                        if (expected.convertedImage.isNull() || expected.outOfGamutMask.isNull())
+                        {
+                            std::printf("MISSING %s\n", qPrintable(imagePath));
+                            ++failures;
+                            continue;
+                        }
+                    }
+                    else
+                    {
+                        expected = ReferenceConverter::convert(
+                            input.image, sourceInfo.profile, targetInfo.profile, type.type, options.threadCount
+                        );
+                    }
+
+                    if (mode == VerificationMode::WriteGolden)
+                    {
+                        if (!expected.convertedImage.save(imagePath) || !expected.outOfGamutMask.save(maskPath))
+                        {
+                            std::printf("FAILED to write %s\n", qPrintable(imagePath));
+                            ++failures;
+                        }
+                        continue;
+                    }
+
+                    ColorTransform transform(sourceInfo.profile, targetInfo.profile, type.type);
+                    for (ConversionKernels::InstructionSet instructionSet : instructionSets)
+                    {
+                        transform.setInstructionSet(instructionSet);
+                        const ComparisonResult result =
+                            difference.compare(expected, transform.convert(input.image, options));
+                        ++comparisons;
+
+                        worst.maxDeltaE         = std::max(worst.maxDeltaE, result.maxDeltaE);
+                        worst.meanDeltaE        = std::max(worst.meanDeltaE, result.meanDeltaE);
+                        worst.maxCodeDifference = std::max(worst.maxCodeDifference, result.maxCodeDifference);
+                        worst.maskMismatches    = std::max(worst.maskMismatches, result.maskMismatches);
+                        if (result.passes(tolerance))
+                        {
+                            continue;
+                        }
+
+                        ++failures;
+                        if (!result.sameSize)
+                        {
+                            std::printf(
+                                "FAIL %s -> %s, %s, %s, %s: size differs\n", sourceInfo.name, targetInfo.name,
+                                type.name, qPrintable(input.name), ConversionKernels::name(instructionSet)
+                            );
+                            continue;
+                        }
+                        std::printf(
+                            "FAIL %s -> %s, %s, %s, %s: max dE %.3f at (%d, %d), mean dE %.4f, max code difference "
+                            "%d, %lld mask mismatches\n",
+                            sourceInfo.name, targetInfo.name, type.name, qPrintable(input.name),
+                            ConversionKernels::name(instructionSet), result.maxDeltaE, result.worstPixel.x(),
+                            result.worstPixel.y(), result.meanDeltaE, result.maxCodeDifference,
+                            static_cast<long long>(result.maskMismatches)
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    if (mode == VerificationMode::WriteGolden)
+    {
+        std::printf("Wrote golden images to %s\n", qPrintable(goldenDirectory.absolutePath()));
+    }
+    else
+    {
+        std::printf(
+            "%d of %d comparisons passed; worst dE %.3f, mean dE %.4f, code difference %d, mask mismatches %lld\n",
+            comparisons - failures, comparisons, worst.maxDeltaE, worst.meanDeltaE, worst.maxCodeDifference,
+            static_cast<long long>(worst.maskMismatches)
+        );
+    }
+    return failures;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures ImageSpaceConverter throughput for every intent and maskImage.");
+    parser.addHelpOption();
+    const QCommandLineOption sizesOption(
+        "sizes", "Comma separated synthetic image sizes in megapixels.", "megapixels", "1,4,16,100"
+    );
+    const QCommandLineOption iterationsOption("iterations", "Runs per measurement, the fastest counts.", "count", "3");
+    const QCommandLineOption threadsOption("threads", "Threads per conversion, 0 uses every core.", "count", "0");
+    const QCommandLineOption kernelOption(
+        "kernel", "Scalar, SSE4.1, AVX2 or AVX-512 (default: best supported).", "name"
+    );
+    const QCommandLineOption sourceOption("source", "Source profile name.", "profile", "Adobe RGB");
+    const QCommandLineOption targetOption("target", "Target profile name.", "profile", "sRGB");
+    const QCommandLineOption imagesOption(
+        "images", "Directory with extra images to measure.", "directory", IMAGEPROFILECONVERTER_IMAGES_DIR
+    );
+    const QCommandLineOption jsonOption(
+        "json", "Also write the results as JSON to this file, - for stdout with the table on stderr.", "file"
+    );
+    const QCommandLineOption verifyOption(
+        "verify", "Instead of timing, check every kernel against the reference implementation."
+    );
+    const QCommandLineOption writeGoldenOption(
+        "write-golden", "Instead of timing, store reference outputs as golden images in this directory.", "directory"
+    );
+    const QCommandLineOption checkGoldenOption(
+        "check-golden", "Instead of timing, check every kernel against the golden images in this directory.",
+        "directory"
+    );
+    // Without these every intent is held to ComparisonTolerance::forIntent
+    const QCommandLineOption maxDeltaEOption(
+        "max-delta-e", "Largest CIEDE2000 difference allowed (default: per intent).", "value"
+    );
+    const QCommandLineOption maxMeanDeltaEOption(
+        "max-mean-delta-e", "Largest CIEDE2000 difference allowed on average (default: per intent).", "value"
+    );
+    const QCommandLineOption maxCodeOption(
+        "max-code-diff", "Largest per-channel code value difference allowed (default: per intent).", "value"
+    );
+    const QCommandLineOption maxMaskOption(
+        "max-mask-mismatches", "Out-of-gamut mask pixels allowed to differ (default: per intent).", "count"
+    );
+    parser.addOptions(
+        {sizesOption, iterationsOption, threadsOption, kernelOption, sourceOption, targetOption, imagesOption,
+         jsonOption, verifyOption, writeGoldenOption, checkGoldenOption, maxDeltaEOption, maxMeanDeltaEOption,
+         maxCodeOption, maxMaskOption}
+    );
+    parser.process(application);
+
+    const ColorProfileSettings *sourceProfile = findProfile(parser.value(sourceOption));
+    const ColorProfileSettings *targetProfile = findProfile(parser.value(targetOption));
+    if (sourceProfile == nullptr || targetProfile == nullptr)
+    {
+        std::fprintf(stderr, "Unknown profile name.\n");
+        return 1;
+    }
+
+    ConversionKernels::InstructionSet instructionSet = ConversionKernels::bestInstructionSet();
+    if (parser.isSet(kernelOption) &&
+        (!parseInstructionSet(parser.value(kernelOption), instructionSet) ||
+         !ConversionKernels::isSupported(instructionSet)))
+    {
+        std::fprintf(stderr, "Kernel \"%s\" is not available here.\n", qPrintable(parser.value(kernelOption)));
+        return 1;
+    }
+
+    const int iterations = std::max(1, parser.value(iterationsOption).toInt());
+    ConversionOptions options;
+    options.threadCount = parser.value(threadsOption).toInt();
+
+    if (parser.isSet(verifyOption) || parser.isSet(writeGoldenOption) || parser.isSet(checkGoldenOption))
+    {
+        std::vector<VerificationInput> inputs = {
+            {   "gradient", syntheticImage(256, 256)},
+            {"gamut-edges",      gamutEdgeImage()}
+        };
+        const QDir imagesDirectory(parser.value(imagesOption));
+        for (const QFileInfo &file : imagesDirectory.entryInfoList({"*.jpg", "*.png"}, QDir::Files, QDir::Name))
+        {
+            inputs.push_back({file.completeBaseName(), QImage(file.absoluteFilePath())});
+        }
+
+        VerificationMode mode = VerificationMode::Reference;
+        QDir goldenDirectory;
+        if (parser.isSet(writeGoldenOption))
+        {
+            mode            = VerificationMode::WriteGolden;
+            goldenDirectory = QDir(parser.value(writeGoldenOption));
+            if (!QDir().mkpath(goldenDirectory.absolutePath()))
+            {
+                std::fprintf(stderr, "Cannot create %s\n", qPrintable(goldenDirectory.absolutePath()));
+                return 1;
+            }
+        }
+        else if (parser.isSet(checkGoldenOption))
+        {
+            mode            = VerificationMode::CheckGolden;
+            goldenDirectory = QDir(parser.value(checkGoldenOption));
+        }
+
+        // Every kernel the CPU runs, unless one was picked
+        std::vector<ConversionKernels::InstructionSet> instructionSets;
+        for (auto candidate :
+             {ConversionKernels::InstructionSet::Scalar, ConversionKernels::InstructionSet::SSE41,
+              ConversionKernels::InstructionSet::AVX2, ConversionKernels::InstructionSet::AVX512})
+        {
+            const bool picked = !parser.isSet(kernelOption) || candidate == instructionSet;
+            if (picked && ConversionKernels::isSupported(candidate))
+            {
+                instructionSets.push_back(candidate);
+            }
+        }
+
+        std::vector<ComparisonTolerance> tolerances;
+        for (const auto &type : ConversionTypes::types)
+        {
+            ComparisonTolerance tolerance = ComparisonTolerance::forIntent(type.type);
+            if (parser.isSet(maxDeltaEOption))
+            {
+                tolerance.maxDeltaE = parser.value(maxDeltaEOption).toDouble();
+            }
+            if (parser.isSet(maxMeanDeltaEOption))
+            {
+                tolerance.maxMeanDeltaE = parser.value(maxMeanDeltaEOption).toDouble();
+            }
+            if (parser.isSet(maxCodeOption))
+            {
+                tolerance.maxCodeDifference = parser.value(maxCodeOption).toInt();
+            }
+            if (parser.isSet(maxMaskOption))
+            {
+                tolerance.maxMaskMismatches = parser.value(maxMaskOption).toLongLong();
+            }
+            tolerances.push_back(tolerance);
+        }
+        return verify(inputs, mode, goldenDirectory, instructionSets, tolerances, options) == 0 ? 0 : 1;
+    }
+
+    auto formatName = [](QImage::Format format) -> QString
+    {
+        switch (format)
+        {
+        case QImage::Format_RGB32:
+            return "RGB32";
+        case QImage::Format_ARGB32:
+            return "ARGB32";
+        case QImage::Format_RGB888:
+            return "RGB888";
+        default:
+            return QString("format %1").arg(static_cast<int>(format));
+        }
+    };
+
+    // With the JSON on stdout the table moves to stderr, so the JSON can be piped on as is
+    FILE *table = parser.isSet(jsonOption) && parser.value(jsonOption) == "-" ? stderr : stdout;
+    std::fprintf(
+        table, "Kernel %s, %d threads, %d iterations, %s -> %s\n\n", ConversionKernels::name(instructionSet),
+        options.threadCount > 0 ? options.threadCount : ThreadPool::global().threadCount(), iterations,
+        qPrintable(parser.value(sourceOption)), qPrintable(parser.value(targetOption))
+    );
+    std::fprintf(
+        table, "%-22s %-8s %-22s %9s %10s %9s %8s %8s %10s\n", "image", "format", "operation", "MP", "ms", "MP/s",
+        "ns/px", "allocs", "alloc MB"
+    );
+
+    std::vector<Measurement> measurements;
+    auto report = [&measurements, table](const Measurement &measurement)
+    {
+        const double megapixels = measurement.pixels / 1e6;
+        std::fprintf(
+            table, "%-22s %-8s %-22s %9.2f %10.2f %9.1f %8.2f %8lld %10.1f\n", qPrintable(measurement.image),
+            qPrintable(measurement.format), qPrintable(measurement.operation), megapixels, measurement.seconds * 1e3,
+            megapixels / measurement.seconds, measurement.seconds * 1e9 / measurement.pixels,
+            static_cast<long long>(measurement.allocations), measurement.allocatedBytes / 1e6
+        );
+        std::fflush(table);
+        measurements.push_back(measurement);
+    };
+
+    auto benchmarkImage = [&](const QString &name, const QImage &image)
+    {
+        const qint64 pixels  = static_cast<qint64>(image.width()) * image.height();
+        const QString format = formatName(image.format());
+        ConversionOutput output;
+
+        for (const auto &type : ConversionTypes::types)
+        {
+            report(measure(
+                name, format, type.name, pixels, iterations,
+                [&]()
+                {
+                    // Plan construction is part of every conversion, the same as ImageSpaceConverter::convert
+                    ColorTransform transform(*sourceProfile, *targetProfile, type.type);
+                    transform.setInstructionSet(instructionSet);
+                    output = transform.convert(image, options);
+                }
+            ));
+        }
+
+        report(measure(
+            name, format, "maskImage", pixels, iterations,
+            [&]()
+            {
+                QImage maskedImage = output.convertedImage;
+                ImageSpaceConverter::maskImage(maskedImage, output.outOfGamutMask, options.threadCount);
+            }
+        ));
+
+        // The same overlay painted by the kernels while converting, to compare against a separate maskImage pass
+        ConversionOptions overlayOptions = options;
+        overlayOptions.overlayOutOfGamut = true;
+        report(measure(
+            name, format, "Absolute Colorimetric + overlay", pixels, iterations,
+            [&]()
+            {
+                ColorTransform transform(*sourceProfile, *targetProfile, ConversionType::AbsoluteColorimetric);
+                transform.setInstructionSet(instructionSet);
+                output = transform.convert(image, overlayOptions);
+            }
+        ));
+
+        // Baking once and applying the grid, the way a LUT is reused across images
+        const ColorTransform perceptual(*sourceProfile, *targetProfile, ConversionType::Perceptual);
+        for (int gridSize : {ColorLut3D::SmallGrid, ColorLut3D::MediumGrid, ColorLut3D::LargeGrid})
+        {
+            ColorLut3D lut;
+            report(measure(
+                name, format, QString("Perceptual %1^3 LUT bake").arg(gridSize), pixels, iterations,
+                [&]()
+                {
+                    lut = ColorLut3D(perceptual, gridSize, options.threadCount);
+                }
+            ));
+            report(measure(
+                name, format, QString("Perceptual %1^3 LUT").arg(gridSize), pixels, iterations,
+                [&]()
+                {
+                    output = lut.convert(image, options);
+                }
+            ));
+        }
+    };
+
+    // Synthetic images in a few source formats, generated one size at a time to keep memory down
+    for (const QString &size : parser.value(sizesOption).split(','))
+    {
+        const double megapixels = size.toDouble();
+        if (megapixels <= 0.0)
+        {
+            continue;
+        }
+        const int width    = std::max(1, static_cast<int>(std::sqrt(megapixels * 1e6 * 4.0 / 3.0)));
+        const QImage image = syntheticImage(width, std::max(1, static_cast<int>(megapixels * 1e6 / width)));
+        const QString name = QString("synthetic %1 MP").arg(size.trimmed());
+        benchmarkImage(name, image);
+        benchmarkImage(name, image.convertToFormat(QImage::Format_ARGB32));
+        benchmarkImage(name, image.convertToFormat(QImage::Format_RGB888));
+
+        // Streaming reads JPEG through clip rects; its time per pixel has to stay a small multiple of a plain
+        // decode at every size, which it only does while decoding grows linearly with the image
+        const QTemporaryDir streamDirectory;
+        const QString jpegPath = streamDirectory.filePath("stream.jpg");
+        if (streamDirectory.isValid() && image.save(jpegPath, "JPEG", 90))
+        {
+            const qint64 pixels = static_cast<qint64>(image.width()) * image.height();
+            report(measure(
+                name, "JPEG", "JPEG decode", pixels, iterations,
+                [&]()
+                {
+                    QImageReader(jpegPath).read();
+                }
+            ));
+
+            ColorTransform transform(*sourceProfile, *targetProfile, ConversionType::Perceptual);
+            transform.setInstructionSet(instructionSet);
+            StreamingConverter streamingConverter(transform, StreamingConverter::DefaultStripRows, options);
+            report(measure(
+                name, "JPEG", "Perceptual streamed", pixels, iterations,
+                [&]()
+                {
+                    streamingConverter.convert(jpegPath, streamDirectory.filePath("stream.ppm"));
+                }
+            ));
+        }
+    }
+
+    const QDir imagesDirectory(parser.value(imagesOption));
+    for (const QFileInfo &file : imagesDirectory.entryInfoList({"*.jpg", "*.png"}, QDir::Files, QDir::Name))
+    {
+        const QImage image(file.absoluteFilePath());
+        if (!image.isNull())
+        {
+            benchmarkImage(file.fileName(), image);
+        }
+    }
+
+    if (parser.isSet(jsonOption))
+    {
+        QJsonArray results;
+        for (const Measurement &measurement : measurements)
+        {
+            QJsonObject result;
+            result["image"]               = measurement.image;
+            result["format"]              = measurement.format;
+            result["operation"]           = measurement.operation;
+            result["pixels"]              = static_cast<double>(measurement.pixels);
+            result["seconds"]             = measurement.seconds;
+            result["megapixelsPerSecond"] = measurement.pixels / 1e6 / measurement.seconds;
+            result["nanosecondsPerPixel"] = measurement.seconds * 1e9 / measurement.pixels;
+            result["allocations"]         = static_cast<double>(measurement.allocations);
+            result["allocatedBytes"]      = static_cast<double>(measurement.allocatedBytes);
+            results.append(result);
+        }
+
+        QJsonObject root;
+        root["version"]       = IMAGEPROFILECONVERTER_VERSION;
+        root["qtVersion"]     = qVersion();
+        root["kernel"]        = ConversionKernels::name(instructionSet);
+        root["threads"]       = options.threadCount > 0 ? options.threadCount : ThreadPool::global().threadCount();
+        root["iterations"]    = iterations;
+        root["sourceProfile"] = parser.value(sourceOption);
+        root["targetProfile"] = parser.value(targetOption);
+        root["results"]       = results;
+        const QByteArray json = QJsonDocument(root).toJson();
+
+        const QString path = parser.value(jsonOption);
+        QFile file(path);
+        const bool opened = path == "-" ? file.open(stdout, QIODevice::WriteOnly) : file.open(QIODevice::WriteOnly);
+        if (!opened || file.write(json) != json.size())
+        {
+            std::fprintf(stderr, "Failed to write %s\n", qPrintable(path));
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,417 @@
+#include "ColorLut3D.h"
+#include "ColorTransform.h"
+#include "CommonProfiles.h"
+#include "ConversionTypes.h"
+#include "ImageBufferPool.h"
+#include "StreamingConverter.h"
+#include "ThreadPool.h"
+#include "TransformCache.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Either a name from CommonProfiles or "gamma,whiteX,whiteY,redX,redY,greenX,greenY,blueX,blueY"
+std::optional<ColorProfileSettings> parseProfile(const QString &text)
+{
+    // The last entry is the empty "Custom" placeholder
+    for (int i = 0; i < CommonProfiles::profilesCount - 1; ++i)
+    {
+        if (text.compare(CommonProfiles::profiles[i].name, Qt::CaseInsensitive) == 0)
+        {
+            return CommonProfiles::profiles[i].profile;
+        }
+    }
+
+    const QStringList parts = text.split(',');
+    if (parts.size() != 9)
+    {
+        return std::nullopt;
+    }
+
+    double values[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        bool ok   = false;
+        values[i] = parts[i].trimmed().toDouble(&ok);
+        if (!ok)
+        {
+            return std::nullopt;
+        }
+    }
+
+    return ColorProfileSettings{
+        values[0],
+        {values[1], values[2]},
+        {values[3], values[4]},
+        {values[5], values[6]},
+        {values[7], values[8]}
+    };
+}
+
+std::optional<ConversionType> parseConversionType(const QString &text)
+{
+    for (const auto &info : ConversionTypes::types)
+    {
+        if (text.compare(info.key, Qt::CaseInsensitive) == 0 || text.compare(info.name, Qt::CaseInsensitive) == 0)
+        {
+            return info.type;
+        }
+    }
+    return std::nullopt;
+}
+
+QStringList collectInputs(const QStringList &arguments, bool recursive)
+{
+    QStringList nameFilters;
+    for (const QByteArray &format : QImageReader::supportedImageFormats())
+    {
+        nameFilters << "*." + QString::fromLatin1(format);
+    }
+
+    QStringList files;
+    for (const QString &argument : arguments)
+    {
+        if (!QFileInfo(argument).isDir())
+        {
+            files << argument;
+            continue;
+        }
+
+        QStringList directoryFiles;
+        QDirIterator iterator(
+            argument, nameFilters, QDir::Files, recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags
+        );
+        while (iterator.hasNext())
+        {
+            directoryFiles << iterator.next();
+        }
+        directoryFiles.sort();
+        files << directoryFiles;
+    }
+    return files;
+}
+
+QString outputPath(const QString &inputPath, const QString &outputDirectory, const QString &suffix, const QString &format)
+{
+    const QFileInfo info(inputPath);
+    const QString directory = outputDirectory.isEmpty() ? info.absolutePath() : outputDirectory;
+    const QString extension = format.isEmpty() ? info.suffix() : format;
+    return QDir(directory).filePath(info.completeBaseName() + suffix + "." + extension);
+}
+
+QString profileNames()
+{
+    QStringList names;
+    for (int i = 0; i < CommonProfiles::profilesCount - 1; ++i)
+    {
+        names << QString("\"%1\"").arg(CommonProfiles::profiles[i].name);
+    }
+    return names.join(", ");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("imgconvert-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Converts images between color profiles.\n"
+        "Profiles are one of " + profileNames() +
+        " or \"gamma,whiteX,whiteY,redX,redY,greenX,greenY,blueX,blueY\"."
+    );
+    parser.addHelpOption();
+
+    const QCommandLineOption sourceOption({"s", "source"}, "Source color profile.", "profile");
+    const QCommandLineOption targetOption({"t", "target"}, "Target color profile.", "profile");
+    const QCommandLineOption intentOption(
+        {"i", "intent"}, "Rendering intent: absolute, relative, perceptual or saturation.", "intent", "perceptual"
+    );
+    const QCommandLineOption outputOption(
+        {"o", "output-dir"}, "Directory for converted images (default: next to each input).", "directory"
+    );
+    const QCommandLineOption suffixOption("suffix", "Appended to output file names.", "suffix", "_converted");
+    const QCommandLineOption formatOption(
+        {"f", "format"}, "Output file format, e.g. png (default: same as input).", "format"
+    );
+    const QCommandLineOption jobsOption(
+        {"j", "jobs"}, "Images decoded, converted and encoded at the same time (default: one per core).", "count"
+    );
+    const QCommandLineOption threadsOption(
+        "threads", "Threads converting each image (default: cores shared between jobs).", "count"
+    );
+    const QCommandLineOption overlayOption("overlay", "Paint out-of-gamut pixels magenta.");
+    const QCommandLineOption maskOption("mask", "Also write the out-of-gamut mask next to each output.");
+    const QCommandLineOption recursiveOption({"r", "recursive"}, "Descend into subdirectories of input directories.");
+    const QCommandLineOption stripOption(
+        "strip-rows",
+        "Stream images in strips of this many rows to keep memory bounded; output is written as ppm (default) or bmp.",
+        "rows"
+    );
+    const QCommandLineOption lutOption(
+        "lut",
+        "Convert through a 3D LUT: a node count per axis (17, 33 or 65) bakes one from the profiles, a .cube or ." +
+            QString(ColorLut3D::BinarySuffix) + " file is loaded instead of them.",
+        "nodes|file"
+    );
+    const QCommandLineOption writeLutOption(
+        "write-lut", "Write the LUT to a .cube or ." + QString(ColorLut3D::BinarySuffix) + " file before converting.",
+        "file"
+    );
+    const QCommandLineOption cacheOption(
+        "cache-dir", "Keep built plans and baked LUTs in this directory and reuse them in later runs.", "directory"
+    );
+    parser.addOptions(
+        {sourceOption, targetOption, intentOption, outputOption, suffixOption, formatOption, jobsOption, threadsOption,
+         overlayOption, maskOption, recursiveOption, stripOption, lutOption, writeLutOption, cacheOption}
+    );
+    parser.addPositionalArgument("inputs", "Image files or directories to convert.", "<inputs...>");
+    parser.process(application);
+
+    // A LUT file stands in for the profiles and the intent
+    bool lutNodeCount  = false;
+    const int lutNodes = parser.isSet(lutOption) ? parser.value(lutOption).toInt(&lutNodeCount) : 0;
+    const bool lutFile = parser.isSet(lutOption) && !lutNodeCount;
+
+    const std::optional<ColorProfileSettings> sourceProfile = parseProfile(parser.value(sourceOption));
+    const std::optional<ColorProfileSettings> targetProfile = parseProfile(parser.value(targetOption));
+    const std::optional<ConversionType> conversionType      = parseConversionType(parser.value(intentOption));
+    if (!lutFile && (!sourceProfile || !targetProfile))
+    {
+        std::fprintf(stderr, "Both --source and --target need a valid profile.\n");
+        return 1;
+    }
+    if (!lutFile && !conversionType)
+    {
+        std::fprintf(stderr, "Unknown intent \"%s\".\n", qPrintable(parser.value(intentOption)));
+        return 1;
+    }
+    if (lutNodeCount && (lutNodes < 2 || lutNodes > 256))
+    {
+        std::fprintf(stderr, "--lut needs 2 to 256 nodes per axis.\n");
+        return 1;
+    }
+    if (parser.isSet(lutOption) && parser.isSet(stripOption))
+    {
+        std::fprintf(stderr, "--lut cannot be combined with --strip-rows.\n");
+        return 1;
+    }
+
+    const QString outputDirectory = parser.value(outputOption);
+    if (!outputDirectory.isEmpty() && !QDir().mkpath(outputDirectory))
+    {
+        std::fprintf(stderr, "Cannot create output directory \"%s\".\n", qPrintable(outputDirectory));
+        return 1;
+    }
+
+    const QStringList files = collectInputs(parser.positionalArguments(), parser.isSet(recursiveOption));
+    if (files.isEmpty() && !parser.isSet(writeLutOption))
+    {
+        parser.showHelp(1);
+    }
+
+    TransformCache &cache = TransformCache::global();
+    cache.setDirectory(parser.value(cacheOption));
+    std::optional<ColorTransform> transform;
+    if (!lutFile)
+    {
+        transform.emplace(cache.transform(*sourceProfile, *targetProfile, *conversionType));
+    }
+
+    // Baked or loaded once, then shared by every job
+    ColorLut3D lut;
+    if (lutFile)
+    {
+        QString error;
+        lut = ColorLut3D::load(parser.value(lutOption), &error);
+        if (lut.isNull())
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(lutOption)), qPrintable(error));
+            return 1;
+        }
+    }
+    else if (lutNodeCount || parser.isSet(writeLutOption))
+    {
+        const int gridSize = lutNodeCount ? lutNodes : ColorLut3D::MediumGrid;
+        lut                = cache.lut(*sourceProfile, *targetProfile, *conversionType, gridSize);
+    }
+
+    if (parser.isSet(writeLutOption))
+    {
+        QString error;
+        if (!lut.save(parser.value(writeLutOption), &error))
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(writeLutOption)), qPrintable(error));
+            return 1;
+        }
+        if (files.isEmpty())
+        {
+            return 0;
+        }
+    }
+    // Only --lut converts through the LUT, --write-lut alone keeps the direct conversion
+    const bool useLut = parser.isSet(lutOption);
+
+    const int cores = ThreadPool::global().threadCount();
+    int jobs        = parser.isSet(jobsOption) ? parser.value(jobsOption).toInt() : cores;
+    jobs            = std::clamp(jobs, 1, static_cast<int>(files.size()));
+
+    // Shared by all jobs, so the result, mask and strip buffers of one image are recycled for the next
+    ImageBufferPool bufferPool;
+
+    // Many small images scale best one per core, a few large ones by splitting each across cores
+    ConversionOptions options;
+    options.threadCount       = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt()
+                                                            : std::max(1, cores / jobs);
+    options.overlayOutOfGamut = parser.isSet(overlayOption);
+    options.outOfGamutMask    = parser.isSet(maskOption);
+    options.bufferPool        = &bufferPool;
+
+    const QString suffix  = parser.value(suffixOption);
+    const bool writeMasks = parser.isSet(maskOption);
+    const bool streaming  = parser.isSet(stripOption);
+    const int stripRows   = streaming ? parser.value(stripOption).toInt() : 0;
+    QString format        = parser.value(formatOption);
+    if (streaming && format.isEmpty())
+    {
+        format = "ppm";
+    }
+    if (streaming && !StreamingConverter::canWrite("image." + format))
+    {
+        std::fprintf(stderr, "Streamed output has to be ppm or bmp.\n");
+        return 1;
+    }
+
+    std::atomic<int> nextFile{0};
+    std::atomic<int> failures{0};
+    // Images that were converted and saved but whose mask could not be written, not part of failures
+    std::atomic<int> maskFailures{0};
+    std::atomic<qint64> convertedPixels{0};
+
+    // Every job runs its own decode -> convert -> encode chain, so the stages of different images overlap
+    auto runJob = [&]()
+    {
+        for (int index = nextFile++; index < files.size(); index = nextFile++)
+        {
+            const QString &file = files[index];
+            if (streaming)
+            {
+                const QString target     = outputPath(file, outputDirectory, suffix, format);
+                const QString maskFormat = format.compare("bmp", Qt::CaseInsensitive) == 0 ? "bmp" : "pgm";
+                const QString maskTarget =
+                    writeMasks ? outputPath(file, outputDirectory, suffix + "_mask", maskFormat) : QString();
+
+                StreamingConverter streamingConverter(*transform, stripRows, options);
+                if (!streamingConverter.convert(file, target, maskTarget))
+                {
+                    std::fprintf(stderr, "%s: %s\n", qPrintable(file), qPrintable(streamingConverter.errorString()));
+                    ++failures;
+                    continue;
+                }
+                if (streamingConverter.usedFullDecode())
+                {
+                    std::fprintf(stderr, "%s: format cannot be read in strips, decoded whole\n", qPrintable(file));
+                }
+                const QSize size = streamingConverter.imageSize();
+                convertedPixels += static_cast<qint64>(size.width()) * size.height();
+                continue;
+            }
+
+            QImageReader reader(file);
+            QImage image = reader.read();
+            if (image.isNull())
+            {
+                std::fprintf(stderr, "%s: %s\n", qPrintable(file), qPrintable(reader.errorString()));
+                ++failures;
+                continue;
+            }
+
+            // The decoded image is not needed afterwards, so the direct conversion overwrites it instead of copying
+            ConversionOutput output;
+            if (useLut)
+            {
+                output = lut.convert(image, options);
+            }
+            else
+            {
+                output.outOfGamutMask = transform->convertInPlace(image, options);
+                output.convertedImage = image;
+            }
+
+            const QString target = outputPath(file, outputDirectory, suffix, format);
+            QImageWriter writer(target);
+            if (!writer.write(output.convertedImage))
+            {
+                std::fprintf(stderr, "%s: %s\n", qPrintable(target), qPrintable(writer.errorString()));
+                ++failures;
+                continue;
+            }
+            if (writeMasks)
+            {
+                const QString maskTarget = outputPath(file, outputDirectory, suffix + "_mask", "png");
+                if (!output.outOfGamutMask.save(maskTarget))
+                {
+                    std::fprintf(stderr, "%s: failed to write mask\n", qPrintable(maskTarget));
+                    ++maskFailures;
+                }
+            }
+            convertedPixels += static_cast<qint64>(image.width()) * image.height();
+        }
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < jobs; ++i)
+    {
+        workers.emplace_back(runJob);
+    }
+    runJob();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    const double seconds   = std::max(timer.nsecsElapsed() / 1e9, 1e-9);
+    const int converted    = static_cast<int>(files.size()) - failures;
+    const double megapixel = convertedPixels / 1e6;
+    std::printf(
+        "Converted %d of %d images (%.1f MP) in %.3f s: %.2f images/s, %.1f MP/s (%d jobs x %d threads, %s)\n",
+        converted, static_cast<int>(files.size()), megapixel, seconds, converted / seconds, megapixel / seconds, jobs,
+        options.threadCount, useLut ? "3D LUT" : ConversionKernels::name(transform->instructionSet())
+    );
+    if (maskFailures > 0)
+    {
+        std::printf("Failed to write %d of %d masks\n", maskFailures.load(), converted);
+    }
+    const ImageBufferPool::Statistics poolStatistics = bufferPool.statistics();
+    std::printf(
+        "Buffer pool: %.1f MB peak, %.1f MB allocated, %.1f MB reused\n", poolStatistics.peakBytes / 1e6,
+        poolStatistics.allocatedBytes / 1e6, poolStatistics.reusedBytes / 1e6
+    );
+    if (parser.isSet(cacheOption))
+    {
+        const TransformCache::Statistics statistics = cache.statistics();
+        std::printf(
+            "Transform cache: %lld built, %lld read from %s\n", static_cast<long long>(statistics.misses),
+            static_cast<long long>(statistics.diskHits), qPrintable(cache.directory())
+        );
+    }
+
+    return failures == 0 && maskFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#ifndef IMAGEPROFILECONVERTER_COLORDIFFERENCE_H
+#define IMAGEPROFILECONVERTER_COLORDIFFERENCE_H
+
+#include "ColorProfileSettings.h"
+#include "ConversionTypes.h"
+#include <QPoint>
+#include <QRgb>
+
+// How far a conversion may drift from its expected output before it counts as a regression.
+// The fast paths encode through 8-bit tables and a float matrix, which keeps them within one code value of the
+// reference. A single code value in the shadows is already more than 1 CIEDE2000, hence the room in maxDeltaE, and a
+// pixel within float rounding of the gamut threshold may land on either side of it.
+struct ComparisonTolerance
+{
+    double maxDeltaE         = 3.5;
+    double maxMeanDeltaE     = 0.05;
+    int maxCodeDifference    = 1; // Per channel, in 8-bit code values
+    qint64 maxMaskMismatches = 2;
+
+    // The saturation intent takes the saturation of the source and the lightness of the rounded colorimetric result,
+    // which turns one code value into several on near-neutral pixels, so it gets looser per-pixel limits
+    static ComparisonTolerance forIntent(ConversionType type);
+};
+
+struct ComparisonResult
+{
+    bool sameSize            = true;
+    qint64 pixels            = 0;
+    double maxDeltaE         = 0.0;
+    double meanDeltaE        = 0.0;
+    int maxCodeDifference    = 0;
+    qint64 maskMismatches    = 0;
+    // Where maxDeltaE was found
+    QPoint worstPixel;
+
+    bool passes(const ComparisonTolerance &tolerance) const;
+};
+
+// CIELAB and CIEDE2000 for pixels encoded in one profile, relative to the profile's white point
+class ColorDifference
+{
+    public:
+    explicit ColorDifference(const ColorProfileSettings &profile);
+
+    void toLab(QRgb pixel, double lab[3]) const;
+    static double deltaE2000(const double lab1[3], const double lab2[3]);
+
+    // Compares the converted images in the profile's Lab space and the masks by white / not white
+    ComparisonResult compare(const ConversionOutput &expected, const ConversionOutput &actual) const;
+
+    private:
+    double rgbToXYZ[9];
+    double whiteXYZ[3];
+    double decode[256];
+};
+
+#endif // IMAGEPROFILECONVERTER_COLORDIFFERENCE_H
@@ -0,0 +1,82 @@
+#ifndef IMAGEPROFILECONVERTER_COLORLUT3D_H
+#define IMAGEPROFILECONVERTER_COLORLUT3D_H
+
+#include "ColorTransform.h"
+#include "ConversionTypes.h"
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <memory>
+
+// A ColorTransform baked into an N x N x N grid and applied with tetrahedral interpolation.
+// Every node stores the target codes of its source color and an out-of-gamut flag as four 16-bit channels
+// (code * 257, flag 0 or 65535), red varying fastest. Nodes are evaluated in double precision at their exact,
+// usually fractional, source codes, so a baked intent costs the same per pixel however much math it involves.
+// A pixel counts as out of gamut when its interpolated flag reaches one half, which moves the mask edge by at most
+// one grid cell. Copies share the grid, so one bake serves any number of images and threads.
+class ColorLut3D
+{
+    public:
+    static constexpr int SmallGrid  = 17;
+    static constexpr int MediumGrid = 33;
+    static constexpr int LargeGrid  = 65;
+    static constexpr int MinGrid    = 2;
+    static constexpr int MaxGrid    = 256;
+    static constexpr int Channels   = 4;
+
+    ColorLut3D() = default;
+    // Bakes the nodes in parallel; gridSize is clamped to [MinGrid, MaxGrid]
+    explicit ColorLut3D(const ColorTransform &transform, int gridSize = MediumGrid, int threadCount = 0);
+
+    // Adobe .cube text, for other tools. The format has no place for the out-of-gamut flags, so they are lost on
+    // export and a loaded .cube never marks pixels as out of gamut.
+    static ColorLut3D readCube(const QString &path, QString *errorString = nullptr);
+    bool writeCube(const QString &path, const QString &title = QString(), QString *errorString = nullptr) const;
+
+    // Binary LUT with the flags: a 64-byte header followed by the nodes exactly as data() holds them, little-endian.
+    // Loading maps the file and converts straight from the mapping, so startup does not depend on the grid size.
+    static constexpr const char *BinarySuffix = "lut3d";
+    static ColorLut3D mapBinary(const QString &path, QString *errorString = nullptr);
+    bool writeBinary(const QString &path, QString *errorString = nullptr) const;
+
+    // Picks the format by suffix: .cube or BinarySuffix
+    static ColorLut3D load(const QString &path, QString *errorString = nullptr);
+    bool save(const QString &path, QString *errorString = nullptr) const;
+
+    bool isNull() const { return nodes == nullptr; }
+    int gridSize() const { return size; }
+    // size^3 * Channels values
+    const quint16 *data() const { return nodes.get(); }
+    qint64 sizeInBytes() const { return static_cast<qint64>(size) * size * size * Channels * sizeof(quint16); }
+
+    ConversionOutput convert(const QImage &sourceImage, const ConversionOptions &options = {}) const;
+
+    // Same contract as ColorTransform::convertRow
+    void convertRow(const QRgb *source, QRgb *target, uchar *mask, int width, bool overlayOutOfGamut = false) const;
+
+    using RowKernel = void (*)(
+        const quint16 *nodes, int gridSize, const QRgb *source, QRgb *target, uchar *mask, int width,
+        bool overlayOutOfGamut
+    );
+
+    static void applyRowScalar(
+        const quint16 *nodes, int gridSize, const QRgb *source, QRgb *target, uchar *mask, int width,
+        bool overlayOutOfGamut
+    );
+    // Interpolates the four channels of a pixel in one vector, bit-exact with the scalar kernel
+    static void applyRowSSE41(
+        const quint16 *nodes, int gridSize, const QRgb *source, QRgb *target, uchar *mask, int width,
+        bool overlayOutOfGamut
+    );
+
+    private:
+    int size = 0;
+    // Owns either a baked array or the mapped file the nodes point into
+    std::shared_ptr<const quint16> nodes;
+    RowKernel rowKernel = &applyRowScalar;
+
+    ColorLut3D(int gridSize, std::shared_ptr<const quint16> nodes);
+    void selectKernel();
+};
+
+#endif // IMAGEPROFILECONVERTER_COLORLUT3D_H
@@ -0,0 +1,118 @@
+#ifndef IMAGEPROFILECONVERTER_COLORTRANSFORM_H
+#define IMAGEPROFILECONVERTER_COLORTRANSFORM_H
+
+#include "ColorProfileSettings.h"
+#include "ConversionKernels.h"
+#include "ConversionTypes.h"
+#include "TransferFunction.h"
+#include <QMatrix4x4>
+#include <QRect>
+#include <memory>
+
+// Precompiled conversion plan between two profiles.
+// Chromatic adaptation, RGB -> XYZ, gamut scaling and XYZ -> RGB are folded into a single
+// linear RGB -> linear RGB matrix once, so converting an image only runs the per-pixel work.
+class ColorTransform
+{
+    public:
+    ColorTransform(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType
+    );
+    // Plan around an already computed linear matrix, e.g. one TransformCache read back from disk
+    ColorTransform(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, const QMatrix4x4 &linearSourceToTarget
+    );
+
+    // Linear source RGB -> linear target RGB for the intent, the part of a plan that costs the most to build.
+    // Built-in profile pairs come from the table ProfileMatrices fills at compile time.
+    static QMatrix4x4 computeMatrix(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType
+    );
+
+    static constexpr float OutOfGamutEpsilon = 1e-3f;
+    static constexpr QRgb WhiteMaskPixel     = 0xffffffff;
+    static constexpr QRgb BlackMaskPixel     = 0xff000000;
+    static constexpr QRgb OverlayPixel       = 0xffff00ff;
+
+    ConversionOutput convert(const QImage &sourceImage, const ConversionOptions &options = {}) const;
+    // Converts only region of sourceImage, resized by scale. Shrinking happens before the conversion and growing
+    // after it, so the work follows the smaller of the two pixel counts.
+    ConversionOutput convert(
+        const QImage &sourceImage, const QRect &region, double scale = 1.0, const ConversionOptions &options = {}
+    ) const;
+
+    // Converts caller-owned pixels without allocating anything, for buffers that are not QImages (memory-mapped
+    // files, other pipelines). Rows are bytesPerLine apart and source and target may be the same buffer. Both formats
+    // have to share a kernel: RGB32, ARGB32 or ARGB32_Premultiplied, RGBX64 or RGBA64, RGBX32FPx4 or RGBA32FPx4, and
+    // only premultiplied sources may have premultiplied targets. The target format decides what happens to alpha.
+    // mask is a Format_MonoLSB bitmap of width x height and may be null, which skips it whatever
+    // options.outOfGamutMask says. Returns false, without touching target, for other formats.
+    bool convertPixels(
+        const uchar *source, qsizetype sourceBytesPerLine, QImage::Format sourceFormat, uchar *target,
+        qsizetype targetBytesPerLine, QImage::Format targetFormat, int width, int height, uchar *mask = nullptr,
+        qsizetype maskBytesPerLine = 0, const ConversionOptions &options = {}
+    ) const;
+    // Converts image in its own pixels and returns the mask. An image already in its working format that is not
+    // shared is converted without any copy; other formats are converted to their working format first.
+    QImage convertInPlace(QImage &image, const ConversionOptions &options = {}) const;
+    // Converts source into target and mask, which keep their buffers when they already have the right size and
+    // format, so repeated conversions of same-sized images allocate nothing; new buffers come from the pool
+    void convertInto(const QImage &source, QImage &target, QImage &mask, const ConversionOptions &options = {}) const;
+
+    // Converts one row of 32-bit pixels; source and target may alias. format is RGB32, which writes opaque pixels,
+    // ARGB32, which keeps the alpha of the source, or ARGB32_Premultiplied for premultiplied source and target rows.
+    // mask receives one bit per pixel, laid out like a Format_MonoLSB scanline, and may be null.
+    void convertRow(
+        const QRgb *source, QRgb *target, uchar *mask, int width, bool overlayOutOfGamut = false,
+        QImage::Format format = QImage::Format_RGB32
+    ) const;
+    // The same for Format_RGBA64 rows (four quint16 per pixel) and Format_RGBA32FPx4 rows (four floats per pixel) at
+    // their full precision. Alpha is copied, the color channels are clamped to [0, 1].
+    void
+    convertRow(const quint16 *source, quint16 *target, uchar *mask, int width, bool overlayOutOfGamut = false) const;
+    void convertRow(const float *source, float *target, uchar *mask, int width, bool overlayOutOfGamut = false) const;
+
+    // Format convert() reads and writes images of the given format in: RGB32, ARGB32 or ARGB32_Premultiplied for
+    // 8-bit formats without alpha, with alpha and with premultiplied alpha, RGBA64 (or RGBX64) for formats with more
+    // than 8 bits per channel and RGBA32FPx4 (or RGBX32FPx4) for floating point ones
+    static QImage::Format workingFormat(QImage::Format format);
+    // The same, and ARGB32 for indexed images whose color table has alpha
+    static QImage::Format workingFormat(const QImage &image);
+
+    // Empty Format_MonoLSB mask with black and white as its two colors, from pool when one is given
+    static QImage createMask(const QSize &size, ImageBufferPool *pool = nullptr);
+
+    const QMatrix4x4 &matrix() const { return linearSourceToTarget; }
+    ConversionType type() const { return conversionType; }
+    const ColorProfileSettings &source() const { return sourceProfile; }
+    const ColorProfileSettings &target() const { return targetProfile; }
+    const TransferFunction &sourceTransferFunction() const { return *sourceTransfer; }
+    const TransferFunction &targetTransferFunction() const { return *targetTransfer; }
+
+    // Kernels default to the best one the CPU supports; unsupported requests are ignored
+    void setInstructionSet(ConversionKernels::InstructionSet instructionSet);
+    ConversionKernels::InstructionSet instructionSet() const { return kernelInstructionSet; }
+
+    private:
+    ColorProfileSettings sourceProfile;
+    ColorProfileSettings targetProfile;
+    ConversionType conversionType;
+    QMatrix4x4 linearSourceToTarget;
+    std::shared_ptr<const TransferFunction> sourceTransfer;
+    std::shared_ptr<const TransferFunction> targetTransfer;
+    KernelParameters kernelParameters;
+    ConversionKernels::InstructionSet kernelInstructionSet   = ConversionKernels::InstructionSet::Scalar;
+    ConversionKernels::RowKernel rowKernel                   = &ConversionKernels::convertRowScalar;
+    ConversionKernels::Rgba64RowKernel rgba64RowKernel       = &ConversionKernels::convertRgba64RowScalar;
+    ConversionKernels::RgbaFloatRowKernel rgbaFloatRowKernel = &ConversionKernels::convertRgbaFloatRowScalar;
+
+    // Bytes per pixel of the row kernel that handles format, 0 for formats without one
+    static int kernelPixelBytes(QImage::Format format);
+    // source has to be in its working format and contain region
+    ConversionOutput convertRegion(const QImage &source, const QRect &region, const ConversionOptions &options) const;
+};
+
+#endif // IMAGEPROFILECONVERTER_COLORTRANSFORM_H
@@ -0,0 +1,114 @@
+#ifndef IMAGEPROFILECONVERTER_CONVERSIONKERNELS_H
+#define IMAGEPROFILECONVERTER_CONVERSIONKERNELS_H
+
+#include <QRgb>
+#include <QtGlobal>
+
+// Everything a row kernel needs, flattened out of ColorTransform
+struct KernelParameters
+{
+    const float *decodeLut;     // TransferFunction::DecodeSize entries
+    const uchar *encodeLut;     // TransferFunction::EncodeSize entries plus padding
+    int encodeRoots;            // TransferFunction::encodeRoots() of encodeLut
+    float matrix[9];            // Row-major linear source RGB -> linear target RGB
+    bool overlayOutOfGamut;     // Write ColorTransform::OverlayPixel instead of out-of-gamut colors
+    bool keepSaturation;        // Saturation intent: give the encoded pixel the HSL saturation of the source pixel
+    bool linearSource;          // Gamma 1.0 source: a code decodes to code * (1 / 255) without the table
+    bool linearTarget;          // Gamma 1.0 target: a value encodes to round(value * 255) without the table
+    bool keepAlpha;             // ARGB32 rows: carry the source alpha over instead of writing opaque pixels
+    bool premultiplied;         // ARGB32_Premultiplied rows: convert the straight colors and premultiply them again
+    const float *wideDecodeLut; // TransferFunction::WideDecodeSize + 1 entries, for 16-bit and float rows
+    const float *wideEncodeLut; // TransferFunction::WideEncodeSize + 1 entries
+};
+
+// Row conversion kernels: decode, matrix, out-of-gamut test, encode, and for the Saturation intent a saturation step.
+// That step keeps the HSL hue and lightness L of the encoded pixel. Every HSL channel is L + C * f(hue), with chroma
+// C = S * (1 - |2L - 1|), so swapping in the source saturation only scales the distance of each channel from L:
+// rgb' = L + (rgb - L) * C' / C. It runs on 0..255 codes, where every product before the division is exact in float.
+// The mask is bit-packed like a QImage::Format_MonoLSB row: bit x % 8 of byte x / 8 is set when pixel x is out of
+// gamut, and the bits past width in the last byte are cleared. Vector kernels only hand the scalar kernel remainders
+// that start on a byte boundary. A null mask skips the out-of-gamut test unless the overlay needs it.
+// Premultiplied pixels are divided by alpha in float, 255 / alpha being correctly rounded on every instruction set,
+// and multiplied again in integers the way qPremultiply does it; a pixel with alpha 0 stays transparent black.
+// Wide kernels convert rows of Format_RGBA64 (four quint16 per pixel) or Format_RGBA32FPx4 (four floats) with the
+// interpolated wide tables and the same stages; channels are clamped to [0, 1] and alpha is copied unchanged. They
+// are vectorized with AVX2, narrower instruction sets run the scalar ones and AVX-512 the AVX2 ones.
+// Every instruction set instantiates its kernel once per variant, a combination of the optional stages below, and
+// the public entry points only pick the instantiation for a row; inside the pixel loop nothing tests for a stage.
+// The vector variants live in their own translation units, compiled with the matching instruction set flags,
+// and must produce the same output as the scalar kernel. Those translation units may only use intrinsics and
+// internal helpers; calling shared inline functions from them could leak wider instructions into baseline code.
+class ConversionKernels
+{
+    public:
+    enum class InstructionSet
+    {
+        Scalar,
+        SSE41,
+        AVX2,
+        AVX512
+    };
+
+    using RowKernel =
+        void (*)(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width);
+
+    // Stages a kernel instantiation compiles in or out
+    static constexpr int KeepSaturationStage = 1;
+    static constexpr int LinearSourceStage   = 2; // Decode without the table
+    static constexpr int LinearTargetStage   = 4; // Encode without the table
+    static constexpr int MaskStage           = 8;
+    static constexpr int OverlayStage        = 16;
+    static constexpr int AlphaStage          = 32; // RGB32 rows only, excludes PremultipliedStage
+    static constexpr int PremultipliedStage  = 64; // RGB32 rows only, excludes AlphaStage
+    static constexpr int VariantCount        = 96;
+    // Wide kernels always copy alpha and have no alpha stages
+    static constexpr int WideVariantCount = AlphaStage;
+
+    template <typename Kernel, int Count = VariantCount>
+    struct KernelTable
+    {
+        Kernel kernels[Count];
+    };
+
+    static int variant(const KernelParameters &parameters, bool writeMask);
+
+    using Rgba64RowKernel =
+        void (*)(const KernelParameters &parameters, const quint16 *source, quint16 *target, uchar *mask, int width);
+    using RgbaFloatRowKernel =
+        void (*)(const KernelParameters &parameters, const float *source, float *target, uchar *mask, int width);
+
+    // Widest instruction set both compiled in and supported by the running CPU, detected once
+    static InstructionSet bestInstructionSet();
+    static bool isSupported(InstructionSet instructionSet);
+    static RowKernel kernel(InstructionSet instructionSet);
+    static Rgba64RowKernel rgba64Kernel(InstructionSet instructionSet);
+    static RgbaFloatRowKernel rgbaFloatKernel(InstructionSet instructionSet);
+    static const char *name(InstructionSet instructionSet);
+
+    static void
+    convertRowScalar(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width);
+    static void
+    convertRowSSE41(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width);
+    static void
+    convertRowAVX2(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width);
+    static void
+    convertRowAVX512(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width);
+
+    static void convertRgba64RowScalar(
+        const KernelParameters &parameters, const quint16 *source, quint16 *target, uchar *mask, int width
+    );
+    static void convertRgba64RowAVX2(
+        const KernelParameters &parameters, const quint16 *source, quint16 *target, uchar *mask, int width
+    );
+    static void convertRgbaFloatRowScalar(
+        const KernelParameters &parameters, const float *source, float *target, uchar *mask, int width
+    );
+    static void convertRgbaFloatRowAVX2(
+        const KernelParameters &parameters, const float *source, float *target, uchar *mask, int width
+    );
+
+    private:
+    static InstructionSet detectInstructionSet();
+};
+
+#endif // IMAGEPROFILECONVERTER_CONVERSIONKERNELS_H
@@ -0,0 +1,109 @@
+#ifndef IMAGEPROFILECONVERTER_CONVERSIONPROFILER_H
+#define IMAGEPROFILECONVERTER_CONVERSIONPROFILER_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QtGlobal>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Wall-clock timings and counters of one conversion job: decode, format conversion, the banded kernel loop, scaling,
+// pyramids, encode. Every timed stage becomes an event on the thread it ran on, so a job can be exported as a Chrome
+// trace (chrome://tracing, Perfetto) as well as summarized per stage. Profiling is opt-in through
+// ConversionOptions::profiler; code taking a null profiler records nothing and pays one pointer test per stage,
+// never per pixel. Thread-safe.
+class ConversionProfiler
+{
+    public:
+    // Times its own lifetime as one event; does nothing without a profiler
+    class Scope
+    {
+        public:
+        Scope(ConversionProfiler *profiler, const char *name, const char *category = StageCategory)
+            : profiler(profiler), name(name), category(category), start(profiler ? profiler->now() : 0)
+        {
+        }
+        ~Scope()
+        {
+            if (profiler != nullptr)
+            {
+                profiler->addEvent(name, category, start, profiler->now() - start);
+            }
+        }
+        Scope(const Scope &)            = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        private:
+        ConversionProfiler *profiler;
+        const char *name;
+        const char *category;
+        qint64 start;
+    };
+
+    struct StageSummary
+    {
+        QString name;
+        int count      = 0;
+        qint64 totalNs = 0; // Summed over all events of the stage
+        qint64 firstNs = 0; // Start of the first event
+        qint64 lastNs  = 0; // End of the last event
+        int threads    = 0; // Distinct threads the stage ran on
+    };
+
+    // Events of this category are stages and show up in summaries; bands of the kernel loop are workers
+    static constexpr const char *StageCategory  = "stage";
+    static constexpr const char *WorkerCategory = "worker";
+
+    enum class ExportFormat
+    {
+        Summary,    // toJson()
+        ChromeTrace // toChromeTrace()
+    };
+
+    // Counters the converter fills in
+    static constexpr const char *PixelsCounter     = "pixels";
+    static constexpr const char *OutOfGamutCounter = "outOfGamutPixels"; // Only counted when a mask is written
+    static constexpr const char *AllocatedCounter  = "bytesAllocated";   // Result and mask images, pooled or not
+    static constexpr const char *BusyCounter       = "workerBusyNs";     // Time threads spent in bands
+    static constexpr const char *CapacityCounter   = "workerCapacityNs"; // Wall time of the loops times their threads
+
+    ConversionProfiler();
+
+    // Nanoseconds since the profiler was created
+    qint64 now() const;
+    void addEvent(const char *name, const char *category, qint64 startNs, qint64 durationNs);
+    void add(const char *counter, qint64 value);
+
+    qint64 counter(const char *counter) const;
+    // Stage events grouped by name, in the order the stages started
+    std::vector<StageSummary> stages() const;
+    // Share of the threads given to the kernel loops that was spent converting, 0 before any loop ran
+    double threadUtilization() const;
+
+    // One line for a status bar: per-stage times, megapixels, out-of-gamut share, allocations, utilization
+    QString summaryText() const;
+    // Stages, counters and utilization
+    QJsonObject toJson() const;
+    // Trace Event Format: complete events for every stage and band, the counters as a counter event at the end
+    QJsonObject toChromeTrace() const;
+    bool save(const QString &path, ExportFormat format, QString *errorString = nullptr) const;
+
+    private:
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        int thread;
+        qint64 startNs;
+        qint64 durationNs;
+    };
+
+    const std::chrono::steady_clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    std::map<QString, qint64> counters;
+};
+
+#endif // IMAGEPROFILECONVERTER_CONVERSIONPROFILER_H
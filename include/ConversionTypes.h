@@ -0,0 +1,65 @@
+#ifndef IMAGEPROFILECONVERTER_CONVERSIONTYPES_H
+#define IMAGEPROFILECONVERTER_CONVERSIONTYPES_H
+
+#include <QImage>
+#include <atomic>
+#include <functional>
+
+class ConversionProfiler;
+class ImageBufferPool;
+
+enum class ConversionType
+{
+    AbsoluteColorimetric,
+    RelativeColorimetric,
+    Perceptual,
+    Saturation
+};
+
+class ConversionTypes
+{
+    public:
+    struct ConversionTypeInfo
+    {
+        const char *name;
+        const char *key; // Short name used on the command line and in reports
+        ConversionType type;
+    };
+
+    static constexpr ConversionTypeInfo types[] = {
+        {"Absolute Colorimetric",   "absolute", ConversionType::AbsoluteColorimetric},
+        {"Relative Colorimetric",   "relative", ConversionType::RelativeColorimetric},
+        {           "Perceptual", "perceptual",           ConversionType::Perceptual},
+        {           "Saturation", "saturation",           ConversionType::Saturation}
+    };
+    static constexpr int typesCount = sizeof(types) / sizeof(types[0]);
+};
+
+struct ConversionOptions
+{
+    // Threads working on one image, 0 uses every core. The output does not depend on it.
+    int threadCount = 0;
+    // Paint out-of-gamut pixels magenta while converting, instead of a separate maskImage pass
+    bool overlayOutOfGamut = false;
+    // False leaves ConversionOutput::outOfGamutMask null; the kernels then skip the mask, and the out-of-gamut
+    // test as well unless the overlay needs it
+    bool outOfGamutMask = true;
+    // Called from worker threads whenever a band finished, with the rows converted so far and the total
+    std::function<void(int rowsDone, int rowCount)> progress;
+    // Checked before every band; once set the remaining bands are skipped and the output is incomplete
+    const std::atomic_bool *cancelled = nullptr;
+    // Result and mask images come from this pool when set, see ImageBufferPool
+    ImageBufferPool *bufferPool = nullptr;
+    // Stage timings and counters go here when set; null records nothing, see ConversionProfiler
+    ConversionProfiler *profiler = nullptr;
+};
+
+class ConversionOutput
+{
+    public:
+    QImage convertedImage;
+    // Format_MonoLSB, one bit per pixel; color index 1 (white) marks out-of-gamut pixels
+    QImage outOfGamutMask;
+};
+
+#endif // IMAGEPROFILECONVERTER_CONVERSIONTYPES_H
@@ -0,0 +1,48 @@
+#ifndef IMAGEPROFILECONVERTER_IMAGEBUFFERPOOL_H
+#define IMAGEPROFILECONVERTER_IMAGEBUFFERPOOL_H
+
+#include <QImage>
+#include <QSize>
+#include <memory>
+
+// Recycles the pixel memory of image-sized QImages across conversions. Images from image() hand their buffer back
+// when their last copy goes away, and the next request of the same size and format takes it over instead of
+// allocating and faulting in fresh pages. Idle buffers are kept up to a byte limit and freed beyond it. Buffers are
+// 64-byte aligned. Everything here is thread-safe, and images may outlive the pool: their buffers are freed then.
+class ImageBufferPool
+{
+    public:
+    struct Statistics
+    {
+        qint64 allocatedBytes = 0; // Allocated from the system in total
+        qint64 reusedBytes    = 0; // Handed out again instead of allocated
+        qint64 peakBytes      = 0; // Most bytes held at once, in use and idle
+        qint64 inUseBytes     = 0;
+        qint64 idleBytes      = 0;
+    };
+
+    static constexpr qint64 DefaultIdleBytes = qint64(512) * 1024 * 1024;
+
+    explicit ImageBufferPool(qint64 maxIdleBytes = DefaultIdleBytes);
+    ~ImageBufferPool();
+    ImageBufferPool(const ImageBufferPool &)            = delete;
+    ImageBufferPool &operator=(const ImageBufferPool &) = delete;
+
+    // Uninitialized image, like QImage(size, format)
+    QImage image(const QSize &size, QImage::Format format);
+    // From pool when there is one, a plain QImage otherwise
+    static QImage image(ImageBufferPool *pool, const QSize &size, QImage::Format format);
+
+    Statistics statistics() const;
+    // Frees the idle buffers; the counters stay
+    void trim();
+
+    private:
+    struct State;
+    struct Lease;
+    std::shared_ptr<State> state;
+
+    static void release(void *lease);
+};
+
+#endif // IMAGEPROFILECONVERTER_IMAGEBUFFERPOOL_H
@@ -5,53 +5,53 @@
 #ifndef IMAGEPROFILECONVERTER_IMAGESPACECONVERTER_H
 #define IMAGEPROFILECONVERTER_IMAGESPACECONVERTER_H
 
-#include "functional"
-#include "unordered_map"
+#include "ConversionTypes.h"
 #include <optional>
 #include <QVector3D>
 #include <QImage>
+#include <QRect>
 
 class ColorProfileSettings;
+class ConversionProfiler;
 class QImage;
 class QColor;
 class double2;
 
-enum class ConversionType
-{
-    AbsoluteColorimetric,
-    RelativeColorimetric,
-    Perceptual,
-    Saturation
-};
-
-class ConversionOutput
-{
-    public:
-    QImage convertedImage;
-    QImage outOfGamutMask;
-};
-
 class ImageSpaceConverter
 {
     public:
     static ConversionOutput convert(
         const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
-        ConversionType conversionType
+        ConversionType conversionType, const ConversionOptions &options = {}
+    );
+    // Converts only region of sourceImage, resized by scale, for views that show a small part of a large image
+    static ConversionOutput convert(
+        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, const QRect &region, double scale = 1.0, const ConversionOptions &options = {}
+    );
+    // Converts sourceImage in its own pixels and returns the mask, see ColorTransform::convertInPlace
+    static QImage convertInPlace(
+        QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, const ConversionOptions &options = {}
     );
     static ConversionOutput convertAbsoluteColorimetric(
-        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        const ConversionOptions &options = {}
     );
 
     static ConversionOutput convertRelativeColorimetric(
-        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        const ConversionOptions &options = {}
     );
 
     static ConversionOutput convertPerceptual(
-        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        const ConversionOptions &options = {}
     );
 
     static ConversionOutput convertPreserveSaturation(
-        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        const ConversionOptions &options = {}
     );
 
     // Helper functions
@@ -62,14 +62,20 @@ class ImageSpaceConverter
     static QVector3D
     transformColor(const QVector3D &color, const QMatrix4x4 &sourceRGBtoXYZ, const QMatrix4x4 &targetXYZtoRGB);
     static QVector3D adjustWhitePoint(const QVector3D &color, const double2 &sourceWhite, const double2 &targetWhite);
+    static QMatrix4x4 computeChromaticAdaptationMatrix(const double2 &sourceWhite, const double2 &targetWhite);
+    static QMatrix4x4
+    computeGamutScalingMatrix(const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile);
+
+    // Paints the pixels that are white in mask magenta; does nothing unless mask is exactly the size of image
+    static void
+    maskImage(QImage &image, const QImage &mask, int threadCount = 0, ConversionProfiler *profiler = nullptr);
 
-    static void maskImage(QImage &image, QImage &mask);
+    // Rows handed to one worker at a time, sized so a band is a few hundred KB of pixels
+    static int rowsPerBand(int width);
 
     private:
-    static std::unordered_map<
-        ConversionType,
-        std::function<ConversionOutput(const QImage &, const ColorProfileSettings &, const ColorProfileSettings &)>>
-        conversionMethods;
+    friend class ColorTransform;
+    friend class ReferenceConverter;
 
     static void rgbToHsl(const QVector3D &rgb, float &h, float &s, float &l);
 
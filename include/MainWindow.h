@@ -4,15 +4,27 @@
 #define MAINWINDOW_H
 
 #include "ColorProfileSettings.h"
+#include "ConversionProfiler.h"
+#include "ImageBufferPool.h"
 #include "ImageSpaceConverter.h"
+#include "MipmapPyramid.h"
 #include <QBitmap>
+#include <QCache>
 #include <QComboBox>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMainWindow>
+#include <QProgressBar>
 #include <QPushButton>
 #include <QSlider>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
 
 class MainWindow : public QMainWindow
 {
@@ -28,11 +40,45 @@ class MainWindow : public QMainWindow
     ColorProfileSettings targetProfile;
     ConversionType currentConversionType = ConversionType::Perceptual;
     bool showOutOfGamut                  = false;
-    QImage gamutMask;
+    bool livePreview                     = true;
+    // Every conversion job records stage timings and counters while set; the last profile goes to the status bar
+    bool recordTimings = false;
+    std::shared_ptr<ConversionProfiler> lastProfile;
+
+    // The full-resolution source is only decoded on Convert and Save; until then the labels show a proxy decoded at
+    // label size and live previews convert that proxy
+    QString sourcePath;
+    QImage sourceProxy;
+    // Full-resolution result of the last Convert, dropped as soon as a setting changes
+    ConversionOutput convertedOutput;
+    // Results, masks and tiles of every conversion come from here, so a repeated Convert or preview reuses the
+    // buffers the previous one released
+    ImageBufferPool bufferPool;
+
+    // Both labels are rendered from these at any size and zoom, the full-resolution ones once Convert finished
+    MipmapPyramid sourcePyramid;
+    MipmapPyramid targetPyramid;
+    double zoom                     = 1.0;
+    static constexpr double MaxZoom = 32.0;
+    // Center of the view as a fraction of the image size, moved by dragging either image
+    double viewCenterX = 0.5;
+    double viewCenterY = 0.5;
+    bool dragging      = false;
+    QPoint dragPosition;
+
+    // Zoomed live previews convert the visible tiles of the full-resolution source pyramid, once Convert decoded it.
+    // Keys pack level and tile coordinates; the cost is in KB. Any settings change clears the cache.
+    QCache<quint64, QImage> tileCache;
+    // Tiles a preview job still has to convert, all from one pyramid level
+    struct TileRequest
+    {
+        QImage levelImage;
+        std::vector<std::pair<quint64, QRect>> tiles; // tileCache key and rect on levelImage
+    };
+    static constexpr int TileSize           = 256;
+    static constexpr int TileCacheKilobytes = 64 * 1024;
 
     // UI Elements
-    QPixmap sourceImage;
-    QPixmap targetImage;
     QLabel *sourceImageLabel;
     QLabel *targetImageLabel;
 
@@ -57,15 +103,79 @@ class MainWindow : public QMainWindow
     QPushButton *loadButton;
     QPushButton *saveButton;
     QPushButton *convertButton;
+    QPushButton *cancelButton;
+    QPushButton *exportTimingsButton;
+    QProgressBar *conversionProgress;
+
+    enum class ConversionPurpose
+    {
+        Preview, // Converts sourceProxy for display
+        Convert, // Decodes and converts the full-resolution image and builds the pyramids of both
+        Save     // Writes convertedOutput to savePath, converting the full-resolution image first when there is none
+    };
+
+    struct ConversionJobResult
+    {
+        ConversionOutput output; // Empty for Save jobs
+        MipmapPyramid sourcePyramid;
+        MipmapPyramid targetPyramid;
+        QString error;
+        QString sourcePath; // Image the job was started for
+        std::vector<std::pair<quint64, QImage>> tiles; // Tiles a zoomed Preview converted, by tileCache key
+        std::shared_ptr<ConversionProfiler> profile; // Null unless recordTimings was set
+    };
+
+    // Background conversion; starting a new one cancels the previous, whose result is then ignored
+    QFutureWatcher<ConversionJobResult> *conversionWatcher = nullptr;
+    std::shared_ptr<std::atomic_bool> conversionCancelled;
+    ConversionPurpose conversionPurpose = ConversionPurpose::Preview;
+    int conversionGeneration            = 0;
+    QString savePath;
+
+    // The first edit after a pause previews on the next event loop pass, which folds the nine edits of a profile
+    // pick into one conversion; later edits wait until PreviewDelayMs have passed since the last preview started
+    QTimer *previewTimer;
+    QElapsedTimer lastPreviewStart;
+    static constexpr int PreviewDelayMs = 30;
+
+    void startConversion(ConversionPurpose purpose, const TileRequest &tiles = {});
+    void cancelConversion();
+    void setConversionRunning(bool running);
+    void schedulePreview();
+    void updatePreview();
+    void settingsChanged();
+    void renderViews();
+    QRect visibleRegion(const QSize &imageSize) const;
+    // True while zoomed into a decoded source without a current Convert result, where the proxy would be blurry
+    bool showsTiles() const;
+    // Pyramid level the tiles of region come from when rendered at size, and region on that level
+    int tileLevel(const QRect &region, const QSize &size, QRect &levelRegion) const;
+    static quint64 tileKey(int level, int tileX, int tileY);
+    // Composes region from cached tiles, or returns a null image while any of them still has to be converted
+    QImage renderTiles(const QRect &region, const QSize &size) const;
+    TileRequest missingTiles(const QRect &region, const QSize &size) const;
 
     QGroupBox *createSettingsGroup(const QString &title, ColorProfileControls &settings, ColorProfileSettings &profile);
     void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+    signals:
+    // Emitted from worker threads, generation tells superseded conversions apart
+    void conversionProgressChanged(int generation, int percent);
 
     private slots:
     void onLoadClicked();
     void onSaveClicked();
     void onConvertClicked();
+    void onCancelClicked();
+    void onConversionFinished();
     void onShowOutOfGamutClicked();
+    void onLivePreviewClicked();
+    void onRecordTimingsClicked();
+    void onExportTimingsClicked();
 
     QHBoxLayout *createToolbarLayout();
 
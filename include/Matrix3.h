@@ -0,0 +1,98 @@
+#ifndef IMAGEPROFILECONVERTER_MATRIX3_H
+#define IMAGEPROFILECONVERTER_MATRIX3_H
+
+// Double precision 3x3 matrices and 3-vectors that work in constant expressions, so profile matrices can be
+// computed by the compiler. Only what the profile math needs; QMatrix4x4 remains the type used at runtime.
+struct Vector3
+{
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+
+    constexpr double operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+};
+
+struct Matrix3
+{
+    double m[3][3] = {};
+
+    static constexpr Matrix3 identity() { return diagonal({1.0, 1.0, 1.0}); }
+
+    static constexpr Matrix3 diagonal(const Vector3 &v)
+    {
+        Matrix3 result;
+        result.m[0][0] = v.x;
+        result.m[1][1] = v.y;
+        result.m[2][2] = v.z;
+        return result;
+    }
+
+    static constexpr Matrix3 fromRows(const Vector3 &row0, const Vector3 &row1, const Vector3 &row2)
+    {
+        Matrix3 result;
+        const Vector3 *rows[3] = {&row0, &row1, &row2};
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int column = 0; column < 3; ++column)
+            {
+                result.m[row][column] = (*rows[row])[column];
+            }
+        }
+        return result;
+    }
+
+    constexpr double operator()(int row, int column) const { return m[row][column]; }
+
+    constexpr Matrix3 operator*(const Matrix3 &other) const
+    {
+        Matrix3 result;
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int column = 0; column < 3; ++column)
+            {
+                result.m[row][column] =
+                    m[row][0] * other.m[0][column] + m[row][1] * other.m[1][column] + m[row][2] * other.m[2][column];
+            }
+        }
+        return result;
+    }
+
+    constexpr Vector3 operator*(const Vector3 &v) const
+    {
+        return {
+            m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z, m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+            m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z
+        };
+    }
+
+    constexpr double determinant() const
+    {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    // Adjugate over determinant; a singular matrix gives the identity, like QMatrix4x4::inverted
+    constexpr Matrix3 inverted() const
+    {
+        const double det = determinant();
+        if (det == 0.0)
+        {
+            return identity();
+        }
+
+        Matrix3 result;
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int column = 0; column < 3; ++column)
+            {
+                // Cofactor of the transposed position, with the cyclic index trick supplying the sign
+                const int r0 = (column + 1) % 3, r1 = (column + 2) % 3;
+                const int c0 = (row + 1) % 3, c1 = (row + 2) % 3;
+                result.m[row][column] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+            }
+        }
+        return result;
+    }
+};
+
+#endif // IMAGEPROFILECONVERTER_MATRIX3_H
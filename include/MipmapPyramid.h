@@ -0,0 +1,34 @@
+#ifndef IMAGEPROFILECONVERTER_MIPMAPPYRAMID_H
+#define IMAGEPROFILECONVERTER_MIPMAPPYRAMID_H
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// Successively halved copies of an image, down to a single pixel.
+// Displaying the image at any size then only rescales the nearest level that is still at least as large,
+// by less than a factor of two, instead of filtering the full-resolution image every time.
+class MipmapPyramid
+{
+    public:
+    MipmapPyramid() = default;
+    // Levels are built one after another, each one in parallel row bands; 0 threads uses every core
+    explicit MipmapPyramid(const QImage &image, int threadCount = 0);
+
+    bool isNull() const { return levels.isEmpty(); }
+    QSize size() const { return isNull() ? QSize() : levels.first().size(); }
+    int levelCount() const { return levels.size(); }
+    const QImage &level(int index) const { return levels[index]; }
+    qint64 sizeInBytes() const;
+
+    // region of the full-resolution image, scaled to fit into size keeping its aspect ratio
+    QImage render(const QRect &region, const QSize &size) const;
+    QImage render(const QSize &size) const { return render(QRect(QPoint(0, 0), this->size()), size); }
+
+    private:
+    QVector<QImage> levels;
+
+    static QImage halve(const QImage &image, int threadCount);
+};
+
+#endif // IMAGEPROFILECONVERTER_MIPMAPPYRAMID_H
@@ -0,0 +1,102 @@
+#ifndef IMAGEPROFILECONVERTER_PROFILEMATRICES_H
+#define IMAGEPROFILECONVERTER_PROFILEMATRICES_H
+
+#include "ColorProfileSettings.h"
+#include "ConversionTypes.h"
+#include "Matrix3.h"
+
+// The linear matrices of ColorTransform in double precision. Every function is constexpr: the matrices of the
+// built-in CommonProfiles, alone and for every pair and intent, are evaluated by the compiler into a static table,
+// and the same code runs at runtime only for profiles that are not built in, so both paths give the same numbers.
+class ProfileMatrices
+{
+    public:
+    // XYZ of a chromaticity at Y = 1
+    static constexpr Vector3 xyz(const double2 &chromaticity)
+    {
+        return {chromaticity.x / chromaticity.y, 1.0, (1.0 - chromaticity.x - chromaticity.y) / chromaticity.y};
+    }
+
+    static constexpr Matrix3 rgbToXyz(const ColorProfileSettings &profile)
+    {
+        const Matrix3 primaries = Matrix3::fromRows(
+            {profile.red.x, profile.green.x, profile.blue.x}, {profile.red.y, profile.green.y, profile.blue.y},
+            {1.0 - profile.red.x - profile.red.y, 1.0 - profile.green.x - profile.green.y,
+             1.0 - profile.blue.x - profile.blue.y}
+        );
+        // Scales the primaries so that RGB 1, 1, 1 lands on the white point
+        return primaries * Matrix3::diagonal(primaries.inverted() * xyz(profile.white));
+    }
+
+    static constexpr Matrix3 xyzToRgb(const ColorProfileSettings &profile) { return rgbToXyz(profile).inverted(); }
+
+    // Bradford adaptation from one white to another, in XYZ
+    static constexpr Matrix3 chromaticAdaptation(const double2 &sourceWhite, const double2 &targetWhite)
+    {
+        const Matrix3 bradford =
+            Matrix3::fromRows({0.8951, 0.2664, -0.1614}, {-0.7502, 1.7135, 0.0367}, {0.0389, -0.0685, 1.0296});
+        const Vector3 sourceCone = bradford * xyz(sourceWhite);
+        const Vector3 targetCone = bradford * xyz(targetWhite);
+        return bradford.inverted() *
+               Matrix3::diagonal(
+                   {targetCone.x / sourceCone.x, targetCone.y / sourceCone.y, targetCone.z / sourceCone.z}
+               ) *
+               bradford;
+    }
+
+    // Largest X, Y and Z any single primary reaches
+    static constexpr Vector3 gamutBounds(const ColorProfileSettings &profile)
+    {
+        const Matrix3 matrix = rgbToXyz(profile);
+        double bounds[3]     = {};
+        for (int row = 0; row < 3; ++row)
+        {
+            bounds[row] = matrix(row, 0);
+            for (int column = 1; column < 3; ++column)
+            {
+                bounds[row] = matrix(row, column) > bounds[row] ? matrix(row, column) : bounds[row];
+            }
+        }
+        return {bounds[0], bounds[1], bounds[2]};
+    }
+
+    static constexpr Matrix3
+    gamutScaling(const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile)
+    {
+        const Vector3 sourceMax = gamutBounds(sourceProfile);
+        const Vector3 targetMax = gamutBounds(targetProfile);
+        return Matrix3::diagonal({targetMax.x / sourceMax.x, targetMax.y / sourceMax.y, targetMax.z / sourceMax.z});
+    }
+
+    // Linear source RGB to linear target RGB for an intent
+    static constexpr Matrix3 conversion(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType
+    )
+    {
+        const Matrix3 sourceRGBtoXYZ = rgbToXyz(sourceProfile);
+        const Matrix3 targetXYZtoRGB = xyzToRgb(targetProfile);
+        switch (conversionType)
+        {
+        case ConversionType::RelativeColorimetric:
+            // White point adaptation is applied to the linear source values before they enter XYZ
+            return targetXYZtoRGB * sourceRGBtoXYZ * chromaticAdaptation(sourceProfile.white, targetProfile.white);
+        case ConversionType::Perceptual:
+            return targetXYZtoRGB * gamutScaling(sourceProfile, targetProfile) * sourceRGBtoXYZ;
+        case ConversionType::AbsoluteColorimetric:
+        case ConversionType::Saturation:
+            break;
+        }
+        return targetXYZtoRGB * sourceRGBtoXYZ;
+    }
+
+    // From the compile-time table when the primaries and white points are those of built-in profiles, computed
+    // otherwise
+    static Matrix3 lookup(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType
+    );
+    static Matrix3 lookupRgbToXyz(const ColorProfileSettings &profile);
+};
+
+#endif // IMAGEPROFILECONVERTER_PROFILEMATRICES_H
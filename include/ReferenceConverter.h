@@ -0,0 +1,20 @@
+#ifndef IMAGEPROFILECONVERTER_REFERENCECONVERTER_H
+#define IMAGEPROFILECONVERTER_REFERENCECONVERTER_H
+
+#include "ColorProfileSettings.h"
+#include "ConversionTypes.h"
+#include <QImage>
+
+// The original pixel-by-pixel conversion: std::pow for the transfer curves and the ImageSpaceConverter helpers for
+// every matrix step, nothing precomputed. Far too slow for interactive use; it is the ground truth the optimized
+// paths are checked against.
+class ReferenceConverter
+{
+    public:
+    static ConversionOutput convert(
+        const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, int threadCount = 0
+    );
+};
+
+#endif // IMAGEPROFILECONVERTER_REFERENCECONVERTER_H
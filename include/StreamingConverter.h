@@ -0,0 +1,46 @@
+#ifndef IMAGEPROFILECONVERTER_STREAMINGCONVERTER_H
+#define IMAGEPROFILECONVERTER_STREAMINGCONVERTER_H
+
+#include "ColorTransform.h"
+#include "ConversionTypes.h"
+#include <QSize>
+#include <QString>
+
+// Converts images strip by strip so peak memory follows the strip size instead of the image size.
+// Strips are read sequentially from binary PPM files, or through QImageReader clip rects for formats whose
+// plugin decodes clipped regions (JPEG). Those decode from the top down to every clip, so they are read in eight
+// bands, which holds an eighth of the image but keeps decoding linear; anything else is decoded whole.
+// Converted rows go straight to a binary PPM or uncompressed BMP file, since Qt's encoders need the full image.
+class StreamingConverter
+{
+    public:
+    static constexpr int DefaultStripRows = 256;
+
+    explicit StreamingConverter(
+        const ColorTransform &transform, int stripRows = DefaultStripRows, const ConversionOptions &options = {}
+    );
+
+    // maskPath is optional and written as a grayscale image in the same format as outputPath
+    bool convert(const QString &inputPath, const QString &outputPath, const QString &maskPath = {});
+
+    // Output files have to end in one of these
+    static bool canWrite(const QString &path);
+
+    QString errorString() const { return lastError; }
+    // True when the last input could not be read in strips and was decoded whole
+    bool usedFullDecode() const { return fullDecode; }
+    qint64 peakStripBytes() const { return peakBytes; }
+    QSize imageSize() const { return size; }
+
+    private:
+    const ColorTransform &transform;
+    int stripRows;
+    ConversionOptions options;
+
+    QString lastError;
+    bool fullDecode  = false;
+    qint64 peakBytes = 0;
+    QSize size;
+};
+
+#endif // IMAGEPROFILECONVERTER_STREAMINGCONVERTER_H
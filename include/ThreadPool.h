@@ -0,0 +1,50 @@
+#ifndef IMAGEPROFILECONVERTER_THREADPOOL_H
+#define IMAGEPROFILECONVERTER_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running index ranges with work stealing.
+// Every participant of a parallelFor starts with a contiguous share of the indices and, once done,
+// steals half of what is left from the others, so uneven rows still keep every core busy.
+class ThreadPool
+{
+    public:
+    // 0 starts one worker per hardware thread (the calling thread counts as one of them)
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Shared pool used by the converter
+    static ThreadPool &global();
+
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Runs task(index) for every index in [0, count) and returns once all of them finished.
+    // The calling thread takes part in the work, so nested calls from inside a task cannot deadlock.
+    // maxThreads limits the participants for this call, 0 uses the whole pool.
+    void parallelFor(int count, const std::function<void(int)> &task, int maxThreads = 0);
+
+    private:
+    struct Job;
+
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<Job>> activeJobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsAvailable;
+    bool stopping = false;
+
+    void workerLoop();
+    std::shared_ptr<Job> claimJob(int &slot);
+    void retireJob(const std::shared_ptr<Job> &job);
+    static void runJob(Job &job, int slot);
+};
+
+#endif // IMAGEPROFILECONVERTER_THREADPOOL_H
@@ -0,0 +1,89 @@
+#ifndef IMAGEPROFILECONVERTER_TRANSFERFUNCTION_H
+#define IMAGEPROFILECONVERTER_TRANSFERFUNCTION_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <QtGlobal>
+
+// Lookup tables for a profile's gamma curve.
+// Decoding an 8-bit channel is a direct 256-entry table read. Encoding indexes a table by a root of linear,
+// which spends the resolution on dark values where the curve is steepest and keeps the table small
+// enough to stay in L1. The root is sqrt taken encodeRoots() times, as often as it takes to bring the curve near
+// black back to a slope that 4096 entries resolve within a code: once up to gamma 3, twice up to 6 and so on.
+// 16-bit and float channels cannot be read off a table per code, so the wide tables are interpolated linearly:
+// decoding by the encoded value in [0, 1], encoding again by sqrt(linear). Both stay within a fraction of a 16-bit
+// step of the exact curve, at 80 KB for the pair.
+class TransferFunction
+{
+    public:
+    static constexpr int DecodeSize = 256;
+    static constexpr int EncodeSize = 4096;
+    // Extra entries past the end so vector kernels can gather 32-bit words at any byte index
+    static constexpr int EncodePadding = 4;
+    static constexpr int MaxEncodeRoots = 4;
+    // Intervals of the wide tables, which hold one entry more
+    static constexpr int WideDecodeSize = 4096;
+    static constexpr int WideEncodeSize = 16384;
+
+    explicit TransferFunction(double gamma);
+
+    // Shared tables for a gamma value; tables stay cached while anything still references them
+    static std::shared_ptr<const TransferFunction> forGamma(double gamma);
+
+    double gamma() const { return gammaValue; }
+    // Gamma 1.0; kernels then skip the tables and scale directly
+    bool isIdentity() const { return gammaValue == 1.0; }
+
+    float decode(uchar value) const { return decodeTable[value]; }
+
+    uchar encode(float linear) const { return encodeTable[encodeIndex(linear, encodeRootCount)]; }
+
+    // Square roots encodeIndex takes for this curve, between 1 and MaxEncodeRoots
+    int encodeRoots() const { return encodeRootCount; }
+    static int encodeIndex(float linear, int roots)
+    {
+        // Written so that NaN ends up at 0 as well
+        float root = linear > 0.0f ? (linear < 1.0f ? linear : 1.0f) : 0.0f;
+        for (int i = 0; i < roots; ++i)
+        {
+            root = std::sqrt(root);
+        }
+        return static_cast<int>(root * (EncodeSize - 1) + 0.5f);
+    }
+
+    const float *decodeLut() const { return decodeTable.data(); }
+    const uchar *encodeLut() const { return encodeTable.data(); }
+
+    // Values in [0, 1], anything outside is clamped first
+    float decodeWide(float value) const { return interpolate(wideDecodeTable.data(), WideDecodeSize, value); }
+    float encodeWide(float linear) const
+    {
+        return interpolate(wideEncodeTable.data(), WideEncodeSize, std::sqrt(linear > 0.0f ? linear : 0.0f));
+    }
+
+    // Linear interpolation in a table of size + 1 entries over [0, 1]; the vector kernels repeat these steps exactly
+    static float interpolate(const float *table, int size, float value)
+    {
+        // Written so that NaN ends up at 0 as well
+        const float clamped  = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+        const float position = clamped * static_cast<float>(size);
+        const int index      = std::min(static_cast<int>(position), size - 1);
+        const float fraction = position - static_cast<float>(index);
+        return table[index] + (table[index + 1] - table[index]) * fraction;
+    }
+
+    const float *wideDecodeLut() const { return wideDecodeTable.data(); }
+    const float *wideEncodeLut() const { return wideEncodeTable.data(); }
+
+    private:
+    double gammaValue;
+    int encodeRootCount = 1;
+    std::array<float, DecodeSize> decodeTable;
+    std::array<uchar, EncodeSize + EncodePadding> encodeTable;
+    std::array<float, WideDecodeSize + 1> wideDecodeTable;
+    std::array<float, WideEncodeSize + 1> wideEncodeTable;
+};
+
+#endif // IMAGEPROFILECONVERTER_TRANSFERFUNCTION_H
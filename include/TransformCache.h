@@ -0,0 +1,73 @@
+#ifndef IMAGEPROFILECONVERTER_TRANSFORMCACHE_H
+#define IMAGEPROFILECONVERTER_TRANSFORMCACHE_H
+
+#include "ColorLut3D.h"
+#include "ColorProfileSettings.h"
+#include "ColorTransform.h"
+#include "ConversionTypes.h"
+#include <QByteArray>
+#include <QCache>
+#include <QString>
+#include <mutex>
+
+// Plans and baked LUTs by content: the key is a SHA-256 over both profiles, the intent and the LUT grid size.
+// Lookups go to an in-process LRU first, then to the cache directory (when one is set), and only then build the
+// plan or bake the LUT, storing the result in both. Plans are stored as their linear matrix, LUTs in the binary
+// ColorLut3D format and memory-mapped when read back. Files are written atomically, so several processes may share
+// one directory. Everything here is thread-safe.
+class TransformCache
+{
+    public:
+    // One count per transform() or lut() call; the plan a LUT is baked from is not counted separately
+    struct Statistics
+    {
+        qint64 memoryHits = 0;
+        qint64 diskHits   = 0;
+        qint64 misses     = 0; // Built or baked from scratch
+    };
+
+    // An empty directory keeps the cache in memory only
+    explicit TransformCache(const QString &directory = QString(), int memoryEntries = 64);
+
+    // Shared by ImageSpaceConverter; starts without a directory
+    static TransformCache &global();
+
+    void setDirectory(const QString &directory);
+    QString directory() const;
+
+    ColorTransform transform(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType
+    );
+    // gridSize is clamped like ColorLut3D's, before it is hashed into the key
+    ColorLut3D lut(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, int gridSize = ColorLut3D::MediumGrid
+    );
+
+    Statistics statistics() const;
+    // Drops the in-process entries and resets the counters; files stay
+    void clear();
+
+    // Hex digest naming the files of a plan (gridSize 0) or a LUT
+    static QByteArray key(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, int gridSize = 0
+    );
+
+    private:
+    mutable std::mutex mutex;
+    QString cacheDirectory;
+    QCache<QByteArray, ColorTransform> transforms;
+    QCache<QByteArray, ColorLut3D> luts; // Cost in KB
+    Statistics counters;
+
+    QString filePath(const QByteArray &key, const char *suffix) const;
+    // transform(), counting into counted unless it is null; lut() bakes from the plan without counting it
+    ColorTransform findTransform(
+        const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+        ConversionType conversionType, Statistics *counted
+    );
+};
+
+#endif // IMAGEPROFILECONVERTER_TRANSFORMCACHE_H
@@ -1,10 +1,16 @@
 #include "MainWindow.h"
+#include "TransformCache.h"
 
 #include <QApplication>
+#include <QStandardPaths>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // Plans and LUTs outlive the session, so the next one skips building them for the same profiles
+    TransformCache::global().setDirectory(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/transforms"
+    );
     MainWindow w;
     w.show();
     return a.exec();
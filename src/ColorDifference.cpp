@@ -0,0 +1,198 @@
+#include "ColorDifference.h"
+#include "ColorTransform.h"
+#include "ProfileMatrices.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr double Pi = 3.14159265358979323846;
+
+double degrees(double radians)
+{
+    const double value = radians * 180.0 / Pi;
+    return value < 0.0 ? value + 360.0 : value;
+}
+
+double radians(double degrees)
+{
+    return degrees * Pi / 180.0;
+}
+
+double labComponent(double t)
+{
+    static constexpr double Epsilon = 216.0 / 24389.0;
+    static constexpr double Kappa   = 24389.0 / 27.0;
+    return t > Epsilon ? std::cbrt(t) : (Kappa * t + 16.0) / 116.0;
+}
+} // namespace
+
+ComparisonTolerance ComparisonTolerance::forIntent(ConversionType type)
+{
+    ComparisonTolerance tolerance;
+    if (type == ConversionType::Saturation)
+    {
+        tolerance.maxDeltaE         = 6.0;
+        tolerance.maxMeanDeltaE     = 0.06;
+        tolerance.maxCodeDifference = 6;
+    }
+    return tolerance;
+}
+
+bool ComparisonResult::passes(const ComparisonTolerance &tolerance) const
+{
+    return sameSize && maxDeltaE <= tolerance.maxDeltaE && meanDeltaE <= tolerance.maxMeanDeltaE &&
+           maxCodeDifference <= tolerance.maxCodeDifference && maskMismatches <= tolerance.maxMaskMismatches;
+}
+
+ColorDifference::ColorDifference(const ColorProfileSettings &profile)
+{
+    const Matrix3 matrix = ProfileMatrices::lookupRgbToXyz(profile);
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            rgbToXYZ[row * 3 + column] = matrix(row, column);
+        }
+    }
+
+    whiteXYZ[0] = profile.white.x / profile.white.y;
+    whiteXYZ[1] = 1.0;
+    whiteXYZ[2] = (1.0 - profile.white.x - profile.white.y) / profile.white.y;
+
+    for (int i = 0; i < 256; ++i)
+    {
+        decode[i] = std::pow(i / 255.0, profile.gamma);
+    }
+}
+
+void ColorDifference::toLab(QRgb pixel, double lab[3]) const
+{
+    const double rgb[3] = {decode[qRed(pixel)], decode[qGreen(pixel)], decode[qBlue(pixel)]};
+    double f[3];
+    for (int row = 0; row < 3; ++row)
+    {
+        const double xyz = rgbToXYZ[row * 3] * rgb[0] + rgbToXYZ[row * 3 + 1] * rgb[1] + rgbToXYZ[row * 3 + 2] * rgb[2];
+        f[row]           = labComponent(xyz / whiteXYZ[row]);
+    }
+
+    lab[0] = 116.0 * f[1] - 16.0;
+    lab[1] = 500.0 * (f[0] - f[1]);
+    lab[2] = 200.0 * (f[1] - f[2]);
+}
+
+// Sharma, Wu and Dalal, "The CIEDE2000 Color-Difference Formula: Implementation Notes", with kL = kC = kH = 1
+double ColorDifference::deltaE2000(const double lab1[3], const double lab2[3])
+{
+    const double c1     = std::hypot(lab1[1], lab1[2]);
+    const double c2     = std::hypot(lab2[1], lab2[2]);
+    const double cMean7 = std::pow((c1 + c2) / 2.0, 7.0);
+    const double g      = 0.5 * (1.0 - std::sqrt(cMean7 / (cMean7 + std::pow(25.0, 7.0))));
+
+    const double a1 = (1.0 + g) * lab1[1];
+    const double a2 = (1.0 + g) * lab2[1];
+    const double C1 = std::hypot(a1, lab1[2]);
+    const double C2 = std::hypot(a2, lab2[2]);
+    const double h1 = C1 == 0.0 ? 0.0 : degrees(std::atan2(lab1[2], a1));
+    const double h2 = C2 == 0.0 ? 0.0 : degrees(std::atan2(lab2[2], a2));
+
+    const double deltaL = lab2[0] - lab1[0];
+    const double deltaC = C2 - C1;
+    double deltah       = 0.0;
+    if (C1 * C2 != 0.0)
+    {
+        deltah = h2 - h1;
+        if (deltah > 180.0)
+        {
+            deltah -= 360.0;
+        }
+        else if (deltah < -180.0)
+        {
+            deltah += 360.0;
+        }
+    }
+    const double deltaH = 2.0 * std::sqrt(C1 * C2) * std::sin(radians(deltah / 2.0));
+
+    const double lMean = (lab1[0] + lab2[0]) / 2.0;
+    const double cMean = (C1 + C2) / 2.0;
+    double hMean       = h1 + h2;
+    if (C1 * C2 != 0.0)
+    {
+        if (std::abs(h1 - h2) > 180.0)
+        {
+            hMean += hMean < 360.0 ? 360.0 : -360.0;
+        }
+        hMean /= 2.0;
+    }
+
+    const double t = 1.0 - 0.17 * std::cos(radians(hMean - 30.0)) + 0.24 * std::cos(radians(2.0 * hMean)) +
+                     0.32 * std::cos(radians(3.0 * hMean + 6.0)) - 0.20 * std::cos(radians(4.0 * hMean - 63.0));
+    const double deltaTheta = 30.0 * std::exp(-std::pow((hMean - 275.0) / 25.0, 2.0));
+    const double cMeanPow7  = std::pow(cMean, 7.0);
+    const double rC         = 2.0 * std::sqrt(cMeanPow7 / (cMeanPow7 + std::pow(25.0, 7.0)));
+    const double lOffset    = (lMean - 50.0) * (lMean - 50.0);
+    const double sL         = 1.0 + 0.015 * lOffset / std::sqrt(20.0 + lOffset);
+    const double sC         = 1.0 + 0.045 * cMean;
+    const double sH         = 1.0 + 0.015 * cMean * t;
+    const double rT         = -std::sin(radians(2.0 * deltaTheta)) * rC;
+
+    const double l = deltaL / sL;
+    const double c = deltaC / sC;
+    const double h = deltaH / sH;
+    return std::sqrt(l * l + c * c + h * h + rT * c * h);
+}
+
+ComparisonResult ColorDifference::compare(const ConversionOutput &expected, const ConversionOutput &actual) const
+{
+    ComparisonResult result;
+    if (expected.convertedImage.size() != actual.convertedImage.size() ||
+        expected.outOfGamutMask.size() != actual.outOfGamutMask.size())
+    {
+        result.sameSize = false;
+        return result;
+    }
+
+    const QImage expectedImage = expected.convertedImage.convertToFormat(QImage::Format_RGB32);
+    const QImage actualImage   = actual.convertedImage.convertToFormat(QImage::Format_RGB32);
+    const QImage expectedMask  = expected.outOfGamutMask.convertToFormat(QImage::Format_RGB32);
+    const QImage actualMask    = actual.outOfGamutMask.convertToFormat(QImage::Format_RGB32);
+
+    double deltaESum = 0.0;
+    for (int y = 0; y < expectedImage.height(); ++y)
+    {
+        const QRgb *expectedRow     = reinterpret_cast<const QRgb *>(expectedImage.constScanLine(y));
+        const QRgb *actualRow       = reinterpret_cast<const QRgb *>(actualImage.constScanLine(y));
+        const QRgb *expectedMaskRow = reinterpret_cast<const QRgb *>(expectedMask.constScanLine(y));
+        const QRgb *actualMaskRow   = reinterpret_cast<const QRgb *>(actualMask.constScanLine(y));
+        for (int x = 0; x < expectedImage.width(); ++x)
+        {
+            const QRgb e = expectedRow[x];
+            const QRgb a = actualRow[x];
+            result.maxCodeDifference =
+                std::max({result.maxCodeDifference, std::abs(qRed(e) - qRed(a)), std::abs(qGreen(e) - qGreen(a)),
+                          std::abs(qBlue(e) - qBlue(a))});
+
+            if ((e & 0xffffff) != (a & 0xffffff))
+            {
+                double expectedLab[3], actualLab[3];
+                toLab(e, expectedLab);
+                toLab(a, actualLab);
+                const double deltaE = deltaE2000(expectedLab, actualLab);
+                deltaESum += deltaE;
+                if (deltaE > result.maxDeltaE)
+                {
+                    result.maxDeltaE  = deltaE;
+                    result.worstPixel = QPoint(x, y);
+                }
+            }
+
+            const bool expectedOutOfGamut = expectedMaskRow[x] == ColorTransform::WhiteMaskPixel;
+            const bool actualOutOfGamut   = actualMaskRow[x] == ColorTransform::WhiteMaskPixel;
+            result.maskMismatches += expectedOutOfGamut != actualOutOfGamut;
+        }
+    }
+
+    result.pixels     = static_cast<qint64>(expectedImage.width()) * expectedImage.height();
+    result.meanDeltaE = result.pixels > 0 ? deltaESum / result.pixels : 0.0;
+    return result;
+}
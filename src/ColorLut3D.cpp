@@ -0,0 +1,482 @@
+#include "ColorLut3D.h"
+#include "ImageBufferPool.h"
+#include "ImageSpaceConverter.h"
+#include "ThreadPool.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// Linear interpolation weight of a code between two nodes, in 1/255 steps so it is exact for every code
+void cellPosition(int code, int gridSize, int &index, int &weight)
+{
+    const int scaled = code * (gridSize - 1);
+    index            = scaled / 255;
+    weight           = scaled % 255;
+    // The top code sits on the last node; interpolate towards it from the cell below instead of past it
+    if (index == gridSize - 1)
+    {
+        index  = gridSize - 2;
+        weight = 255;
+    }
+}
+
+// Binary file layout, all fields little-endian; the nodes start at BinaryDataOffset
+constexpr char BinaryMagic[8]     = {'I', 'P', 'C', 'L', 'U', 'T', '3', 'D'};
+constexpr quint32 BinaryVersion   = 1;
+constexpr qint64 BinaryDataOffset = 64;
+constexpr qint64 BinaryVersionAt  = 8;
+constexpr qint64 BinaryGridSizeAt = 12;
+constexpr qint64 BinaryChannelsAt = 16;
+
+std::shared_ptr<quint16> allocateNodes(int gridSize)
+{
+    const qint64 valueCount = static_cast<qint64>(gridSize) * gridSize * gridSize * ColorLut3D::Channels;
+    return std::shared_ptr<quint16>(new quint16[valueCount], std::default_delete<quint16[]>());
+}
+
+void setError(QString *errorString, const QString &message)
+{
+    if (errorString != nullptr)
+    {
+        *errorString = message;
+    }
+}
+
+bool isCube(const QString &path)
+{
+    return QFileInfo(path).suffix().compare("cube", Qt::CaseInsensitive) == 0;
+}
+} // namespace
+
+ColorLut3D::ColorLut3D(int gridSize, std::shared_ptr<const quint16> nodes) : size(gridSize), nodes(std::move(nodes))
+{
+    selectKernel();
+}
+
+ColorLut3D::ColorLut3D(const ColorTransform &transform, int gridSize, int threadCount)
+    : size(std::clamp(gridSize, MinGrid, MaxGrid))
+{
+    std::shared_ptr<quint16> baked = allocateNodes(size);
+    quint16 *values                = baked.get();
+
+    double m[9];
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            m[row * 3 + column] = transform.matrix()(row, column);
+        }
+    }
+    const double sourceGamma  = transform.sourceTransferFunction().gamma();
+    const double targetGamma  = transform.targetTransferFunction().gamma();
+    const bool keepSaturation = transform.type() == ConversionType::Saturation;
+    const double epsilon      = ColorTransform::OutOfGamutEpsilon;
+    const int nodeCount       = size;
+
+    // One blue slice per task
+    ThreadPool::global().parallelFor(
+        size,
+        [&](int blue)
+        {
+            quint16 *node = values + static_cast<qint64>(blue) * nodeCount * nodeCount * Channels;
+            for (int green = 0; green < nodeCount; ++green)
+            {
+                for (int red = 0; red < nodeCount; ++red, node += Channels)
+                {
+                    const double source[3] = {
+                        red * 255.0 / (nodeCount - 1), green * 255.0 / (nodeCount - 1), blue * 255.0 / (nodeCount - 1)
+                    };
+                    double linear[3];
+                    for (int channel = 0; channel < 3; ++channel)
+                    {
+                        linear[channel] = std::pow(source[channel] / 255.0, sourceGamma);
+                    }
+
+                    double code[3];
+                    bool outOfGamut = false;
+                    for (int channel = 0; channel < 3; ++channel)
+                    {
+                        const double value = m[channel * 3] * linear[0] + m[channel * 3 + 1] * linear[1] +
+                                             m[channel * 3 + 2] * linear[2];
+                        outOfGamut    = outOfGamut || value < -epsilon || value > 1.0 + epsilon;
+                        code[channel] = std::pow(std::clamp(value, 0.0, 1.0), 1.0 / targetGamma) * 255.0;
+                    }
+
+                    if (keepSaturation)
+                    {
+                        // ConversionKernels' saturation step, on fractional codes and without the final rounding
+                        const double sourceMax   = std::max({source[0], source[1], source[2]});
+                        const double sourceMin   = std::min({source[0], source[1], source[2]});
+                        const double targetMax   = std::max({code[0], code[1], code[2]});
+                        const double targetMin   = std::min({code[0], code[1], code[2]});
+                        const double sourceRange = 255.0 - std::abs(sourceMax + sourceMin - 255.0);
+                        const double targetRange = 255.0 - std::abs(targetMax + targetMin - 255.0);
+                        const double scale       = (sourceMax - sourceMin) * targetRange /
+                                             std::max(sourceRange * (targetMax - targetMin), 1.0);
+                        const double lightness = (targetMax + targetMin) * 0.5;
+                        for (double &channel : code)
+                        {
+                            channel = std::clamp(lightness + (channel - lightness) * scale, 0.0, 255.0);
+                        }
+                    }
+
+                    for (int channel = 0; channel < 3; ++channel)
+                    {
+                        node[channel] = static_cast<quint16>(std::lround(code[channel] * 257.0));
+                    }
+                    node[3] = outOfGamut ? 65535 : 0;
+                }
+            }
+        },
+        threadCount
+    );
+
+    nodes = std::move(baked);
+    selectKernel();
+}
+
+void ColorLut3D::selectKernel()
+{
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+    if (ConversionKernels::isSupported(ConversionKernels::InstructionSet::SSE41))
+    {
+        rowKernel = &applyRowSSE41;
+        return;
+    }
+#endif
+    rowKernel = &applyRowScalar;
+}
+
+ColorLut3D ColorLut3D::readCube(const QString &path, QString *errorString)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        setError(errorString, file.errorString());
+        return ColorLut3D();
+    }
+
+    int gridSize = 0;
+    std::shared_ptr<quint16> values;
+    qint64 valueCount = 0;
+    qint64 nodesRead  = 0;
+    while (!file.atEnd())
+    {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        const QByteArray &keyword      = fields.front();
+        if (keyword == "LUT_3D_SIZE")
+        {
+            gridSize = fields.size() == 2 ? fields[1].toInt() : 0;
+            if (gridSize < MinGrid || gridSize > MaxGrid || values != nullptr)
+            {
+                setError(errorString, "Invalid LUT_3D_SIZE");
+                return ColorLut3D();
+            }
+            values     = allocateNodes(gridSize);
+            valueCount = static_cast<qint64>(gridSize) * gridSize * gridSize;
+        }
+        else if (keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX")
+        {
+            const QByteArray expected = keyword == "DOMAIN_MIN" ? "0" : "1";
+            for (int i = 1; i < fields.size(); ++i)
+            {
+                if (fields[i].toDouble() != expected.toDouble())
+                {
+                    setError(errorString, "Only the default 0 to 1 domain is supported");
+                    return ColorLut3D();
+                }
+            }
+        }
+        else if (keyword == "LUT_1D_SIZE")
+        {
+            setError(errorString, "1D LUTs are not supported");
+            return ColorLut3D();
+        }
+        else if (std::isalpha(static_cast<uchar>(keyword.front())))
+        {
+            // TITLE and keywords of other tools carry nothing the conversion needs
+        }
+        else
+        {
+            if (values == nullptr || fields.size() != 3 || nodesRead == valueCount)
+            {
+                setError(errorString, "Unexpected data line in .cube file");
+                return ColorLut3D();
+            }
+            quint16 *node = values.get() + nodesRead * Channels;
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                bool ok            = false;
+                const double value = fields[channel].toDouble(&ok);
+                if (!ok)
+                {
+                    setError(errorString, "Invalid number in .cube file");
+                    return ColorLut3D();
+                }
+                node[channel] = static_cast<quint16>(std::lround(std::clamp(value, 0.0, 1.0) * 65535.0));
+            }
+            node[3] = 0;
+            ++nodesRead;
+        }
+    }
+
+    if (values == nullptr || nodesRead != valueCount)
+    {
+        setError(errorString, "Incomplete .cube file");
+        return ColorLut3D();
+    }
+    return ColorLut3D(gridSize, std::move(values));
+}
+
+bool ColorLut3D::writeCube(const QString &path, const QString &title, QString *errorString) const
+{
+    QSaveFile file(path);
+    if (isNull() || !file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        setError(errorString, isNull() ? QString("Nothing to write") : file.errorString());
+        return false;
+    }
+
+    QByteArray text;
+    if (!title.isEmpty())
+    {
+        text += "TITLE \"" + title.toUtf8() + "\"\n";
+    }
+    text += "LUT_3D_SIZE " + QByteArray::number(size) + "\n";
+    text += "DOMAIN_MIN 0.0 0.0 0.0\nDOMAIN_MAX 1.0 1.0 1.0\n";
+
+    // Same node order as .cube: red varies fastest, then green, then blue
+    const qint64 nodeCount = static_cast<qint64>(size) * size * size;
+    const quint16 *node    = nodes.get();
+    for (qint64 i = 0; i < nodeCount; ++i, node += Channels)
+    {
+        text += QByteArray::number(node[0] / 65535.0, 'f', 6) + ' ' + QByteArray::number(node[1] / 65535.0, 'f', 6) +
+                ' ' + QByteArray::number(node[2] / 65535.0, 'f', 6) + '\n';
+    }
+
+    if (file.write(text) != text.size() || !file.commit())
+    {
+        setError(errorString, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+ColorLut3D ColorLut3D::mapBinary(const QString &path, QString *errorString)
+{
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        setError(errorString, file->errorString());
+        return ColorLut3D();
+    }
+
+    const uchar *mapped = file->size() >= BinaryDataOffset ? file->map(0, file->size()) : nullptr;
+    if (mapped == nullptr || std::memcmp(mapped, BinaryMagic, sizeof(BinaryMagic)) != 0)
+    {
+        setError(errorString, "Not a binary LUT file");
+        return ColorLut3D();
+    }
+
+    const quint32 version  = qFromLittleEndian<quint32>(mapped + BinaryVersionAt);
+    const quint32 gridSize = qFromLittleEndian<quint32>(mapped + BinaryGridSizeAt);
+    const quint32 channels = qFromLittleEndian<quint32>(mapped + BinaryChannelsAt);
+    const qint64 dataBytes = static_cast<qint64>(gridSize) * gridSize * gridSize * Channels * sizeof(quint16);
+    if (version != BinaryVersion || channels != Channels || gridSize < MinGrid || gridSize > MaxGrid ||
+        file->size() < BinaryDataOffset + dataBytes)
+    {
+        setError(errorString, "Unsupported or truncated binary LUT file");
+        return ColorLut3D();
+    }
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // The nodes keep the file, and with it the mapping, alive
+    const quint16 *mappedNodes = reinterpret_cast<const quint16 *>(mapped + BinaryDataOffset);
+    return ColorLut3D(static_cast<int>(gridSize), std::shared_ptr<const quint16>(file, mappedNodes));
+#else
+    std::shared_ptr<quint16> values = allocateNodes(static_cast<int>(gridSize));
+    qFromLittleEndian<quint16>(mapped + BinaryDataOffset, dataBytes / sizeof(quint16), values.get());
+    return ColorLut3D(static_cast<int>(gridSize), std::move(values));
+#endif
+}
+
+bool ColorLut3D::writeBinary(const QString &path, QString *errorString) const
+{
+    QSaveFile file(path);
+    if (isNull() || !file.open(QIODevice::WriteOnly))
+    {
+        setError(errorString, isNull() ? QString("Nothing to write") : file.errorString());
+        return false;
+    }
+
+    QByteArray header(BinaryDataOffset, '\0');
+    uchar *bytes = reinterpret_cast<uchar *>(header.data());
+    std::memcpy(bytes, BinaryMagic, sizeof(BinaryMagic));
+    qToLittleEndian<quint32>(BinaryVersion, bytes + BinaryVersionAt);
+    qToLittleEndian<quint32>(static_cast<quint32>(size), bytes + BinaryGridSizeAt);
+    qToLittleEndian<quint32>(Channels, bytes + BinaryChannelsAt);
+
+    QByteArray data(sizeInBytes(), Qt::Uninitialized);
+    qToLittleEndian<quint16>(nodes.get(), sizeInBytes() / sizeof(quint16), data.data());
+
+    if (file.write(header) != header.size() || file.write(data) != data.size() || !file.commit())
+    {
+        setError(errorString, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+ColorLut3D ColorLut3D::load(const QString &path, QString *errorString)
+{
+    return isCube(path) ? readCube(path, errorString) : mapBinary(path, errorString);
+}
+
+bool ColorLut3D::save(const QString &path, QString *errorString) const
+{
+    return isCube(path) ? writeCube(path, QFileInfo(path).completeBaseName(), errorString)
+                        : writeBinary(path, errorString);
+}
+
+ConversionOutput ColorLut3D::convert(const QImage &sourceImage, const ConversionOptions &options) const
+{
+    if (isNull())
+    {
+        return ConversionOutput();
+    }
+
+    const QImage source = sourceImage.convertToFormat(QImage::Format_RGB32);
+    QImage resultImage    = ImageBufferPool::image(options.bufferPool, source.size(), QImage::Format_RGB32);
+    QImage outOfGamutMask =
+        options.outOfGamutMask ? ColorTransform::createMask(source.size(), options.bufferPool) : QImage();
+
+    // Raw pointers are taken up front, scanLine() on a shared image is not safe to call from several threads
+    const uchar *sourceBits = source.constBits();
+    uchar *resultBits       = resultImage.bits();
+    uchar *maskBits         = outOfGamutMask.isNull() ? nullptr : outOfGamutMask.bits();
+    const int width         = source.width();
+    const int height        = source.height();
+
+    const int bandRows  = ImageSpaceConverter::rowsPerBand(width);
+    const int bandCount = (height + bandRows - 1) / bandRows;
+    std::atomic_int rowsDone(0);
+    ThreadPool::global().parallelFor(
+        bandCount,
+        [&](int band)
+        {
+            if (options.cancelled != nullptr && options.cancelled->load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            const int firstRow = band * bandRows;
+            const int lastRow  = std::min(height, firstRow + bandRows);
+            for (int y = firstRow; y < lastRow; ++y)
+            {
+                convertRow(
+                    reinterpret_cast<const QRgb *>(sourceBits + y * source.bytesPerLine()),
+                    reinterpret_cast<QRgb *>(resultBits + y * resultImage.bytesPerLine()),
+                    maskBits ? maskBits + y * outOfGamutMask.bytesPerLine() : nullptr, width,
+                    options.overlayOutOfGamut
+                );
+            }
+
+            if (options.progress)
+            {
+                options.progress(rowsDone += lastRow - firstRow, height);
+            }
+        },
+        options.threadCount
+    );
+
+    return {resultImage, outOfGamutMask};
+}
+
+void ColorLut3D::convertRow(const QRgb *source, QRgb *target, uchar *mask, int width, bool overlayOutOfGamut) const
+{
+    rowKernel(nodes.get(), size, source, target, mask, width, overlayOutOfGamut);
+}
+
+void ColorLut3D::applyRowScalar(
+    const quint16 *nodes, int gridSize, const QRgb *source, QRgb *target, uchar *mask, int width,
+    bool overlayOutOfGamut
+)
+{
+    const int strides[3] = {Channels, gridSize * Channels, gridSize * gridSize * Channels};
+
+    uchar maskByte = 0;
+    for (int x = 0; x < width; ++x)
+    {
+        const QRgb pixel = source[x];
+        int index[3], weight[3];
+        cellPosition(qRed(pixel), gridSize, index[0], weight[0]);
+        cellPosition(qGreen(pixel), gridSize, index[1], weight[1]);
+        cellPosition(qBlue(pixel), gridSize, index[2], weight[2]);
+
+        // Axes by descending weight pick the tetrahedron of the cell that contains the pixel
+        int order[3] = {0, 1, 2};
+        if (weight[order[0]] < weight[order[1]])
+        {
+            std::swap(order[0], order[1]);
+        }
+        if (weight[order[1]] < weight[order[2]])
+        {
+            std::swap(order[1], order[2]);
+        }
+        if (weight[order[0]] < weight[order[1]])
+        {
+            std::swap(order[0], order[1]);
+        }
+
+        const quint16 *v0 = nodes + index[0] * strides[0] + index[1] * strides[1] + index[2] * strides[2];
+        const quint16 *v1 = v0 + strides[order[0]];
+        const quint16 *v2 = v1 + strides[order[1]];
+        const quint16 *v3 = v2 + strides[order[2]];
+        const int w0      = 255 - weight[order[0]];
+        const int w1      = weight[order[0]] - weight[order[1]];
+        const int w2      = weight[order[1]] - weight[order[2]];
+        const int w3      = weight[order[2]];
+
+        // Weights add up to 255 and nodes hold code * 257, so sums divide by 65535 to give codes
+        int sums[Channels];
+        for (int channel = 0; channel < Channels; ++channel)
+        {
+            sums[channel] = w0 * v0[channel] + w1 * v1[channel] + w2 * v2[channel] + w3 * v3[channel];
+        }
+
+        const bool outOfGamut = sums[3] >= 255 * 32768;
+        maskByte |= static_cast<uchar>(outOfGamut) << (x & 7);
+        if ((x & 7) == 7 && mask != nullptr)
+        {
+            mask[x >> 3] = maskByte;
+            maskByte     = 0;
+        }
+
+        if (outOfGamut && overlayOutOfGamut)
+        {
+            target[x] = ColorTransform::OverlayPixel;
+        }
+        else
+        {
+            target[x] = qRgb((sums[0] + 32767) / 65535, (sums[1] + 32767) / 65535, (sums[2] + 32767) / 65535);
+        }
+    }
+    if ((width & 7) != 0 && mask != nullptr)
+    {
+        mask[width >> 3] = maskByte;
+    }
+}
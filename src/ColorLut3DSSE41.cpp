@@ -0,0 +1,216 @@
+#include "ColorLut3D.h"
+#include "ColorTransform.h"
+
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+#include <immintrin.h>
+
+namespace
+{
+// Same as cellPosition in ColorLut3D.cpp
+inline void cellPosition(int code, int gridSize, int &index, int &weight)
+{
+    const int scaled = code * (gridSize - 1);
+    index            = scaled / 255;
+    weight           = scaled % 255;
+    if (index == gridSize - 1)
+    {
+        index  = gridSize - 2;
+        weight = 255;
+    }
+}
+
+// Four lanes of cellPosition; scaled stays below 2^16, where (scaled * 0x8081) >> 23 equals scaled / 255
+inline void cellPositions(__m128i codes, __m128i lastIndex, __m128i &index, __m128i &weight)
+{
+    const __m128i scaled = _mm_mullo_epi32(codes, lastIndex);
+    index                = _mm_srli_epi32(_mm_mullo_epi32(scaled, _mm_set1_epi32(0x8081)), 23);
+    weight               = _mm_sub_epi32(scaled, _mm_mullo_epi32(index, _mm_set1_epi32(255)));
+
+    const __m128i atEnd = _mm_cmpeq_epi32(index, lastIndex);
+    index               = _mm_add_epi32(index, atEnd); // atEnd lanes are -1
+    weight              = _mm_blendv_epi8(weight, _mm_set1_epi32(255), atEnd);
+}
+
+// Swaps two ints without std::swap, a shared template this translation unit must not instantiate
+inline void swapInts(int &a, int &b)
+{
+    const int first = a;
+    a               = b;
+    b               = first;
+}
+
+// Moves the larger weight and its stride to the first axis in every lane
+inline void sortAxes(__m128i &weightA, __m128i &strideA, __m128i &weightB, __m128i &strideB)
+{
+    const __m128i swapped = _mm_cmplt_epi32(weightA, weightB);
+    const __m128i larger  = _mm_max_epi32(weightA, weightB);
+    const __m128i stride  = _mm_blendv_epi8(strideA, strideB, swapped);
+    weightB               = _mm_min_epi32(weightA, weightB);
+    strideB               = _mm_blendv_epi8(strideB, strideA, swapped);
+    weightA               = larger;
+    strideA               = stride;
+}
+
+// The four 16-bit channels of a node widened to 32-bit lanes
+inline __m128i loadNode(const quint16 *node)
+{
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(node)));
+}
+
+// (sum + 32767) / 65535 without a division, exact for every sum the weights can produce
+inline __m128i roundToCodes(__m128i sums)
+{
+    const __m128i rounded = _mm_add_epi32(sums, _mm_set1_epi32(32767));
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(rounded, _mm_srli_epi32(rounded, 16)), _mm_set1_epi32(1)), 16);
+}
+} // namespace
+
+void ColorLut3D::applyRowSSE41(
+    const quint16 *nodes, int gridSize, const QRgb *source, QRgb *target, uchar *mask, int width,
+    bool overlayOutOfGamut
+)
+{
+    const int strides[3]    = {Channels, gridSize * Channels, gridSize * gridSize * Channels};
+    const __m128i lastIndex = _mm_set1_epi32(gridSize - 1);
+    const __m128i byteMask  = _mm_set1_epi32(0xff);
+    const __m128i flagLimit = _mm_set1_epi32(255 * 32768 - 1);
+    const __m128i opaque    = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    const __m128i overlay   = _mm_set1_epi32(static_cast<int>(ColorTransform::OverlayPixel));
+
+    uchar maskByte = 0;
+    int x          = 0;
+    // Cells, weights and tetrahedra of four pixels in lanes; the nodes are then weighted one pixel per vector
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x));
+        __m128i index[3], weight[3];
+        cellPositions(_mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask), lastIndex, index[0], weight[0]);
+        cellPositions(_mm_and_si128(_mm_srli_epi32(pixels, 8), byteMask), lastIndex, index[1], weight[1]);
+        cellPositions(_mm_and_si128(pixels, byteMask), lastIndex, index[2], weight[2]);
+
+        // Equal weights may end up in either order: the vertex between them gets weight zero
+        __m128i stride[3] = {_mm_set1_epi32(strides[0]), _mm_set1_epi32(strides[1]), _mm_set1_epi32(strides[2])};
+        const __m128i v0  = _mm_add_epi32(
+            _mm_add_epi32(_mm_mullo_epi32(index[0], stride[0]), _mm_mullo_epi32(index[1], stride[1])),
+            _mm_mullo_epi32(index[2], stride[2])
+        );
+        sortAxes(weight[0], stride[0], weight[1], stride[1]);
+        sortAxes(weight[1], stride[1], weight[2], stride[2]);
+        sortAxes(weight[0], stride[0], weight[1], stride[1]);
+
+        alignas(16) int offsets[4][4];
+        alignas(16) int weights[4][4];
+        const __m128i v1 = _mm_add_epi32(v0, stride[0]);
+        const __m128i v2 = _mm_add_epi32(v1, stride[1]);
+        _mm_store_si128(reinterpret_cast<__m128i *>(offsets[0]), v0);
+        _mm_store_si128(reinterpret_cast<__m128i *>(offsets[1]), v1);
+        _mm_store_si128(reinterpret_cast<__m128i *>(offsets[2]), v2);
+        _mm_store_si128(reinterpret_cast<__m128i *>(offsets[3]), _mm_add_epi32(v2, stride[2]));
+        _mm_store_si128(reinterpret_cast<__m128i *>(weights[0]), _mm_sub_epi32(_mm_set1_epi32(255), weight[0]));
+        _mm_store_si128(reinterpret_cast<__m128i *>(weights[1]), _mm_sub_epi32(weight[0], weight[1]));
+        _mm_store_si128(reinterpret_cast<__m128i *>(weights[2]), _mm_sub_epi32(weight[1], weight[2]));
+        _mm_store_si128(reinterpret_cast<__m128i *>(weights[3]), weight[2]);
+
+        // Sums of a pixel hold R, G, B and the flag
+        __m128i sums[4];
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            __m128i sum = _mm_mullo_epi32(loadNode(nodes + offsets[0][lane]), _mm_set1_epi32(weights[0][lane]));
+            for (int vertex = 1; vertex < 4; ++vertex)
+            {
+                const __m128i node = loadNode(nodes + offsets[vertex][lane]);
+                sum                = _mm_add_epi32(sum, _mm_mullo_epi32(node, _mm_set1_epi32(weights[vertex][lane])));
+            }
+            sums[lane] = sum;
+        }
+
+        // Transposed to one channel of four pixels per vector
+        const __m128i low01  = _mm_unpacklo_epi32(sums[0], sums[1]);
+        const __m128i high01 = _mm_unpackhi_epi32(sums[0], sums[1]);
+        const __m128i low23  = _mm_unpacklo_epi32(sums[2], sums[3]);
+        const __m128i high23 = _mm_unpackhi_epi32(sums[2], sums[3]);
+        const __m128i red    = roundToCodes(_mm_unpacklo_epi64(low01, low23));
+        const __m128i green  = roundToCodes(_mm_unpackhi_epi64(low01, low23));
+        const __m128i blue   = roundToCodes(_mm_unpacklo_epi64(high01, high23));
+        const __m128i flags  = _mm_unpackhi_epi64(high01, high23);
+
+        const __m128i outOfGamut = _mm_cmpgt_epi32(flags, flagLimit);
+        maskByte |= static_cast<uchar>(_mm_movemask_ps(_mm_castsi128_ps(outOfGamut)) << (x & 7));
+        if ((x & 7) == 4 && mask != nullptr)
+        {
+            mask[x >> 3] = maskByte;
+            maskByte     = 0;
+        }
+
+        __m128i result = _mm_or_si128(
+            _mm_or_si128(opaque, _mm_slli_epi32(red, 16)), _mm_or_si128(_mm_slli_epi32(green, 8), blue)
+        );
+        if (overlayOutOfGamut)
+        {
+            result = _mm_blendv_epi8(result, overlay, outOfGamut);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), result);
+    }
+
+    // Lanes hold R, G, B and the flag; QRgb wants B, G, R in its low bytes
+    const __m128i toPixel = _mm_setr_epi8(8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    for (; x < width; ++x)
+    {
+        const QRgb pixel = source[x];
+        int index[3], weight[3];
+        cellPosition((pixel >> 16) & 0xff, gridSize, index[0], weight[0]);
+        cellPosition((pixel >> 8) & 0xff, gridSize, index[1], weight[1]);
+        cellPosition(pixel & 0xff, gridSize, index[2], weight[2]);
+
+        int order[3] = {0, 1, 2};
+        if (weight[order[0]] < weight[order[1]])
+        {
+            swapInts(order[0], order[1]);
+        }
+        if (weight[order[1]] < weight[order[2]])
+        {
+            swapInts(order[1], order[2]);
+        }
+        if (weight[order[0]] < weight[order[1]])
+        {
+            swapInts(order[0], order[1]);
+        }
+
+        const quint16 *v0 = nodes + index[0] * strides[0] + index[1] * strides[1] + index[2] * strides[2];
+        const quint16 *v1 = v0 + strides[order[0]];
+        const quint16 *v2 = v1 + strides[order[1]];
+        const quint16 *v3 = v2 + strides[order[2]];
+
+        const __m128i w0 = _mm_set1_epi32(255 - weight[order[0]]);
+        const __m128i w1 = _mm_set1_epi32(weight[order[0]] - weight[order[1]]);
+        const __m128i w2 = _mm_set1_epi32(weight[order[1]] - weight[order[2]]);
+        const __m128i w3 = _mm_set1_epi32(weight[order[2]]);
+
+        __m128i sums = _mm_mullo_epi32(loadNode(v0), w0);
+        sums         = _mm_add_epi32(sums, _mm_mullo_epi32(loadNode(v1), w1));
+        sums         = _mm_add_epi32(sums, _mm_mullo_epi32(loadNode(v2), w2));
+        sums         = _mm_add_epi32(sums, _mm_mullo_epi32(loadNode(v3), w3));
+
+        const bool outOfGamut = _mm_extract_epi32(sums, 3) >= 255 * 32768;
+        maskByte |= static_cast<uchar>(outOfGamut) << (x & 7);
+        if ((x & 7) == 7 && mask != nullptr)
+        {
+            mask[x >> 3] = maskByte;
+            maskByte     = 0;
+        }
+
+        if (outOfGamut && overlayOutOfGamut)
+        {
+            target[x] = ColorTransform::OverlayPixel;
+            continue;
+        }
+
+        const __m128i codes = roundToCodes(sums);
+        target[x]           = static_cast<QRgb>(_mm_cvtsi128_si32(_mm_shuffle_epi8(codes, toPixel))) | 0xff000000u;
+    }
+    if ((width & 7) != 0 && mask != nullptr)
+    {
+        mask[width >> 3] = maskByte;
+    }
+}
+#endif
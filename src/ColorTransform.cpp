@@ -0,0 +1,441 @@
+#include "ColorTransform.h"
+#include "ConversionProfiler.h"
+#include "ImageBufferPool.h"
+#include "ImageSpaceConverter.h"
+#include "ProfileMatrices.h"
+#include "ThreadPool.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+// Out-of-gamut pixels of rows of a bit-packed mask, whose bits past width are clear
+qint64 countMaskBits(const uchar *mask, qsizetype bytesPerLine, int width, int rows)
+{
+    qint64 count = 0;
+    for (int y = 0; y < rows; ++y, mask += bytesPerLine)
+    {
+        for (int x = 0; x < (width + 7) / 8; ++x)
+        {
+            count += qPopulationCount(mask[x]);
+        }
+    }
+    return count;
+}
+} // namespace
+
+ColorTransform::ColorTransform(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType
+)
+    : ColorTransform(
+          sourceProfile, targetProfile, conversionType, computeMatrix(sourceProfile, targetProfile, conversionType)
+      )
+{
+}
+
+ColorTransform::ColorTransform(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, const QMatrix4x4 &linearSourceToTarget
+)
+    : sourceProfile(sourceProfile), targetProfile(targetProfile), conversionType(conversionType),
+      linearSourceToTarget(linearSourceToTarget), sourceTransfer(TransferFunction::forGamma(sourceProfile.gamma)),
+      targetTransfer(TransferFunction::forGamma(targetProfile.gamma))
+{
+    kernelParameters.decodeLut         = sourceTransfer->decodeLut();
+    kernelParameters.encodeLut         = targetTransfer->encodeLut();
+    kernelParameters.encodeRoots       = targetTransfer->encodeRoots();
+    kernelParameters.overlayOutOfGamut = false;
+    kernelParameters.keepSaturation    = conversionType == ConversionType::Saturation;
+    kernelParameters.linearSource      = sourceTransfer->isIdentity();
+    kernelParameters.linearTarget      = targetTransfer->isIdentity();
+    kernelParameters.keepAlpha         = false;
+    kernelParameters.premultiplied     = false;
+    kernelParameters.wideDecodeLut     = sourceTransfer->wideDecodeLut();
+    kernelParameters.wideEncodeLut     = targetTransfer->wideEncodeLut();
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            kernelParameters.matrix[row * 3 + column] = linearSourceToTarget(row, column);
+        }
+    }
+    setInstructionSet(ConversionKernels::bestInstructionSet());
+}
+
+QMatrix4x4 ColorTransform::computeMatrix(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType
+)
+{
+    // The kernels run in float, the matrix itself is built in double
+    const Matrix3 matrix = ProfileMatrices::lookup(sourceProfile, targetProfile, conversionType);
+    QMatrix4x4 result;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            result(row, column) = static_cast<float>(matrix(row, column));
+        }
+    }
+    return result;
+}
+
+void ColorTransform::setInstructionSet(ConversionKernels::InstructionSet instructionSet)
+{
+    ConversionKernels::RowKernel selected = ConversionKernels::kernel(instructionSet);
+    if (selected != nullptr)
+    {
+        kernelInstructionSet = instructionSet;
+        rowKernel            = selected;
+        rgba64RowKernel      = ConversionKernels::rgba64Kernel(instructionSet);
+        rgbaFloatRowKernel   = ConversionKernels::rgbaFloatKernel(instructionSet);
+    }
+}
+
+QImage::Format ColorTransform::workingFormat(QImage::Format format)
+{
+    switch (format)
+    {
+    case QImage::Format_RGBX64:
+        return QImage::Format_RGBX64;
+    case QImage::Format_RGBA64:
+    case QImage::Format_RGBA64_Premultiplied:
+    case QImage::Format_Grayscale16:
+    case QImage::Format_BGR30:
+    case QImage::Format_A2BGR30_Premultiplied:
+    case QImage::Format_RGB30:
+    case QImage::Format_A2RGB30_Premultiplied:
+        return QImage::Format_RGBA64;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    case QImage::Format_RGBX32FPx4:
+    case QImage::Format_RGBX16FPx4:
+        return QImage::Format_RGBX32FPx4;
+    case QImage::Format_RGBA32FPx4:
+    case QImage::Format_RGBA32FPx4_Premultiplied:
+    case QImage::Format_RGBA16FPx4:
+    case QImage::Format_RGBA16FPx4_Premultiplied:
+        return QImage::Format_RGBA32FPx4;
+#endif
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_Alpha8:
+        return QImage::Format_ARGB32;
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBA8888_Premultiplied:
+    case QImage::Format_ARGB8565_Premultiplied:
+    case QImage::Format_ARGB6666_Premultiplied:
+    case QImage::Format_ARGB8555_Premultiplied:
+    case QImage::Format_ARGB4444_Premultiplied:
+        return QImage::Format_ARGB32_Premultiplied;
+    default:
+        return QImage::Format_RGB32;
+    }
+}
+
+QImage::Format ColorTransform::workingFormat(const QImage &image)
+{
+    const QImage::Format format = workingFormat(image.format());
+    return format == QImage::Format_RGB32 && image.hasAlphaChannel() ? QImage::Format_ARGB32 : format;
+}
+
+ConversionOutput ColorTransform::convert(const QImage &sourceImage, const ConversionOptions &options) const
+{
+    QImage working;
+    {
+        // No copy when the source already is in its working format
+        ConversionProfiler::Scope scope(options.profiler, "convertToFormat");
+        working = sourceImage.convertToFormat(workingFormat(sourceImage));
+    }
+    return convertRegion(working, sourceImage.rect(), options);
+}
+
+ConversionOutput ColorTransform::convert(
+    const QImage &sourceImage, const QRect &region, double scale, const ConversionOptions &options
+) const
+{
+    const QRect clipped = region.intersected(sourceImage.rect());
+    if (clipped.isEmpty() || scale <= 0.0)
+    {
+        return ConversionOutput();
+    }
+    const QSize outputSize(
+        std::max(1, qRound(clipped.width() * scale)), std::max(1, qRound(clipped.height() * scale))
+    );
+
+    ConversionOutput output;
+    if (scale < 1.0)
+    {
+        QImage shrunk;
+        {
+            // Shrinking first leaves only the output pixels to convert
+            ConversionProfiler::Scope scope(options.profiler, "scale");
+            shrunk = sourceImage.copy(clipped).scaled(outputSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        output = convert(shrunk, options);
+    }
+    else if (sourceImage.format() == workingFormat(sourceImage))
+    {
+        output = convertRegion(sourceImage, clipped, options);
+    }
+    else
+    {
+        output = convert(sourceImage.copy(clipped), options);
+    }
+
+    if (output.convertedImage.size() != outputSize)
+    {
+        ConversionProfiler::Scope scope(options.profiler, "scale");
+        output.convertedImage =
+            output.convertedImage.scaled(outputSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        if (!output.outOfGamutMask.isNull())
+        {
+            output.outOfGamutMask =
+                output.outOfGamutMask.scaled(outputSize, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        }
+    }
+    return output;
+}
+
+ConversionOutput ColorTransform::convertRegion(
+    const QImage &source, const QRect &region, const ConversionOptions &options
+) const
+{
+    QImage resultImage;
+    QImage outOfGamutMask;
+    {
+        ConversionProfiler::Scope scope(options.profiler, "allocate");
+        resultImage    = ImageBufferPool::image(options.bufferPool, region.size(), workingFormat(source.format()));
+        outOfGamutMask = options.outOfGamutMask ? createMask(region.size(), options.bufferPool) : QImage();
+    }
+    if (options.profiler != nullptr)
+    {
+        options.profiler->add(
+            ConversionProfiler::AllocatedCounter, resultImage.sizeInBytes() + outOfGamutMask.sizeInBytes()
+        );
+    }
+    const uchar *sourceBits =
+        source.constBits() + region.y() * source.bytesPerLine() + region.x() * (source.depth() / 8);
+
+    // Fresh images, so bits() does not detach
+    convertPixels(
+        sourceBits, source.bytesPerLine(), source.format(), resultImage.bits(), resultImage.bytesPerLine(),
+        resultImage.format(), region.width(), region.height(),
+        outOfGamutMask.isNull() ? nullptr : outOfGamutMask.bits(), outOfGamutMask.bytesPerLine(), options
+    );
+    return {resultImage, outOfGamutMask};
+}
+
+int ColorTransform::kernelPixelBytes(QImage::Format format)
+{
+    switch (format)
+    {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return sizeof(QRgb);
+    case QImage::Format_RGBX64:
+    case QImage::Format_RGBA64:
+        return 4 * sizeof(quint16);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    case QImage::Format_RGBX32FPx4:
+    case QImage::Format_RGBA32FPx4:
+        return 4 * sizeof(float);
+#endif
+    default:
+        return 0;
+    }
+}
+
+bool ColorTransform::convertPixels(
+    const uchar *source, qsizetype sourceBytesPerLine, QImage::Format sourceFormat, uchar *target,
+    qsizetype targetBytesPerLine, QImage::Format targetFormat, int width, int height, uchar *mask,
+    qsizetype maskBytesPerLine, const ConversionOptions &options
+) const
+{
+    const int pixelBytes = kernelPixelBytes(sourceFormat);
+    // Premultiplied targets need premultiplied sources and the other way round, except for wide formats
+    const bool premultipliedSource = sourceFormat == QImage::Format_ARGB32_Premultiplied;
+    const bool premultipliedTarget = targetFormat == QImage::Format_ARGB32_Premultiplied;
+    if (pixelBytes == 0 || pixelBytes != kernelPixelBytes(targetFormat) || premultipliedSource != premultipliedTarget)
+    {
+        return false;
+    }
+    if (!options.outOfGamutMask)
+    {
+        mask = nullptr;
+    }
+
+    const int bandRows  = ImageSpaceConverter::rowsPerBand(width);
+    const int bandCount = (height + bandRows - 1) / bandRows;
+    std::atomic_int rowsDone(0);
+    // Without a profiler all of this is a pointer test per band
+    ConversionProfiler *profiler = options.profiler;
+    ConversionProfiler::Scope scope(profiler, "convert");
+    const qint64 loopStart = profiler != nullptr ? profiler->now() : 0;
+    std::atomic<qint64> busyNs(0);
+    std::atomic<qint64> outOfGamutPixels(0);
+    ThreadPool::global().parallelFor(
+        bandCount,
+        [&](int band)
+        {
+            if (options.cancelled != nullptr && options.cancelled->load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            const qint64 bandStart = profiler != nullptr ? profiler->now() : 0;
+            const int firstRow     = band * bandRows;
+            const int lastRow      = std::min(height, firstRow + bandRows);
+            for (int y = firstRow; y < lastRow; ++y)
+            {
+                const uchar *sourceRow = source + y * sourceBytesPerLine;
+                uchar *targetRow       = target + y * targetBytesPerLine;
+                uchar *maskRow         = mask ? mask + y * maskBytesPerLine : nullptr;
+                switch (pixelBytes)
+                {
+                case sizeof(QRgb):
+                    convertRow(
+                        reinterpret_cast<const QRgb *>(sourceRow), reinterpret_cast<QRgb *>(targetRow), maskRow,
+                        width, options.overlayOutOfGamut, targetFormat
+                    );
+                    break;
+                case 4 * sizeof(quint16):
+                    convertRow(
+                        reinterpret_cast<const quint16 *>(sourceRow), reinterpret_cast<quint16 *>(targetRow),
+                        maskRow, width, options.overlayOutOfGamut
+                    );
+                    break;
+                default:
+                    convertRow(
+                        reinterpret_cast<const float *>(sourceRow), reinterpret_cast<float *>(targetRow), maskRow,
+                        width, options.overlayOutOfGamut
+                    );
+                    break;
+                }
+            }
+
+            if (profiler != nullptr)
+            {
+                const qint64 bandNs = profiler->now() - bandStart;
+                profiler->addEvent("band", ConversionProfiler::WorkerCategory, bandStart, bandNs);
+                busyNs += bandNs;
+                if (mask != nullptr)
+                {
+                    outOfGamutPixels += countMaskBits(
+                        mask + firstRow * maskBytesPerLine, maskBytesPerLine, width, lastRow - firstRow
+                    );
+                }
+            }
+            if (options.progress)
+            {
+                options.progress(rowsDone += lastRow - firstRow, height);
+            }
+        },
+        options.threadCount
+    );
+
+    if (profiler != nullptr)
+    {
+        // The same participant count parallelFor settles on
+        const int poolThreads = ThreadPool::global().threadCount();
+        const int threads =
+            std::min(bandCount, options.threadCount > 0 ? std::min(options.threadCount, poolThreads) : poolThreads);
+        profiler->add(ConversionProfiler::PixelsCounter, static_cast<qint64>(width) * height);
+        profiler->add(ConversionProfiler::OutOfGamutCounter, outOfGamutPixels);
+        profiler->add(ConversionProfiler::BusyCounter, busyNs);
+        profiler->add(ConversionProfiler::CapacityCounter, (profiler->now() - loopStart) * threads);
+    }
+    return true;
+}
+
+QImage ColorTransform::convertInPlace(QImage &image, const ConversionOptions &options) const
+{
+    if (image.format() != workingFormat(image))
+    {
+        ConversionProfiler::Scope scope(options.profiler, "convertToFormat");
+        image = image.convertToFormat(workingFormat(image));
+    }
+    QImage outOfGamutMask;
+    if (options.outOfGamutMask)
+    {
+        ConversionProfiler::Scope scope(options.profiler, "allocate");
+        outOfGamutMask = createMask(image.size(), options.bufferPool);
+    }
+    if (options.profiler != nullptr)
+    {
+        options.profiler->add(ConversionProfiler::AllocatedCounter, outOfGamutMask.sizeInBytes());
+    }
+
+    // bits() only copies when the caller still shares image with someone else
+    uchar *bits = image.bits();
+    convertPixels(
+        bits, image.bytesPerLine(), image.format(), bits, image.bytesPerLine(), image.format(), image.width(),
+        image.height(), outOfGamutMask.isNull() ? nullptr : outOfGamutMask.bits(), outOfGamutMask.bytesPerLine(),
+        options
+    );
+    return outOfGamutMask;
+}
+
+void ColorTransform::convertInto(
+    const QImage &source, QImage &target, QImage &mask, const ConversionOptions &options
+) const
+{
+    const QImage::Format format = workingFormat(source);
+    // No copy when the source already is in its working format
+    const QImage working = source.convertToFormat(format);
+    if (target.size() != source.size() || target.format() != format)
+    {
+        target = ImageBufferPool::image(options.bufferPool, source.size(), format);
+    }
+    if (!options.outOfGamutMask)
+    {
+        mask = QImage();
+    }
+    else if (mask.size() != source.size() || mask.format() != QImage::Format_MonoLSB)
+    {
+        mask = createMask(source.size(), options.bufferPool);
+    }
+
+    convertPixels(
+        working.constBits(), working.bytesPerLine(), working.format(), target.bits(), target.bytesPerLine(), format,
+        source.width(), source.height(), mask.isNull() ? nullptr : mask.bits(), mask.bytesPerLine(), options
+    );
+}
+
+void ColorTransform::convertRow(
+    const QRgb *source, QRgb *target, uchar *mask, int width, bool overlayOutOfGamut, QImage::Format format
+) const
+{
+    KernelParameters parameters  = kernelParameters;
+    parameters.overlayOutOfGamut = overlayOutOfGamut;
+    parameters.keepAlpha         = format == QImage::Format_ARGB32;
+    parameters.premultiplied     = format == QImage::Format_ARGB32_Premultiplied;
+    rowKernel(parameters, source, target, mask, width);
+}
+
+void ColorTransform::convertRow(
+    const quint16 *source, quint16 *target, uchar *mask, int width, bool overlayOutOfGamut
+) const
+{
+    KernelParameters parameters  = kernelParameters;
+    parameters.overlayOutOfGamut = overlayOutOfGamut;
+    rgba64RowKernel(parameters, source, target, mask, width);
+}
+
+void ColorTransform::convertRow(
+    const float *source, float *target, uchar *mask, int width, bool overlayOutOfGamut
+) const
+{
+    KernelParameters parameters  = kernelParameters;
+    parameters.overlayOutOfGamut = overlayOutOfGamut;
+    rgbaFloatRowKernel(parameters, source, target, mask, width);
+}
+
+QImage ColorTransform::createMask(const QSize &size, ImageBufferPool *pool)
+{
+    QImage mask = ImageBufferPool::image(pool, size, QImage::Format_MonoLSB);
+    mask.setColorTable({BlackMaskPixel, WhiteMaskPixel});
+    return mask;
+}
@@ -0,0 +1,486 @@
+#include "ConversionKernels.h"
+#include "ColorTransform.h"
+#include "TransferFunction.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#if defined(IMAGEPROFILECONVERTER_X86_KERNELS) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace
+{
+// Codes of the encoded pixel with the saturation of the source pixel, see ConversionKernels.h
+QRgb keepSaturation(QRgb sourcePixel, float r, float g, float b)
+{
+    const float sourceR = qRed(sourcePixel), sourceG = qGreen(sourcePixel), sourceB = qBlue(sourcePixel);
+    const float sourceMax = std::max(std::max(sourceR, sourceG), sourceB);
+    const float sourceMin = std::min(std::min(sourceR, sourceG), sourceB);
+    const float targetMax = std::max(std::max(r, g), b);
+    const float targetMin = std::min(std::min(r, g), b);
+
+    // Largest chroma possible at each lightness; a gray source or target gives a scale of 0
+    const float sourceRange = 255.0f - std::abs(sourceMax + sourceMin - 255.0f);
+    const float targetRange = 255.0f - std::abs(targetMax + targetMin - 255.0f);
+    const float scale =
+        (sourceMax - sourceMin) * targetRange / std::max(sourceRange * (targetMax - targetMin), 1.0f);
+    const float lightness = (targetMax + targetMin) * 0.5f;
+
+    auto adjust = [&](float channel)
+    {
+        return static_cast<int>(std::min(std::max(lightness + (channel - lightness) * scale, 0.0f), 255.0f) + 0.5f);
+    };
+    return qRgb(adjust(r), adjust(g), adjust(b));
+}
+
+template <bool Linear>
+float decodeChannel(const float *lut, int code)
+{
+    if constexpr (Linear)
+    {
+        return static_cast<float>(code) * (1.0f / 255.0f);
+    }
+    return lut[code];
+}
+
+template <bool Linear>
+uchar encodeChannel(const uchar *lut, int roots, float linear)
+{
+    if constexpr (Linear)
+    {
+        // Written so that NaN ends up at 0 as well
+        const float clamped = linear > 0.0f ? (linear < 1.0f ? linear : 1.0f) : 0.0f;
+        return static_cast<uchar>(clamped * 255.0f + 0.5f);
+    }
+    return lut[TransferFunction::encodeIndex(linear, roots)];
+}
+
+// Straight colors of an ARGB32_Premultiplied pixel, see ConversionKernels.h
+QRgb unpremultiplied(QRgb pixel)
+{
+    const int alpha   = qAlpha(pixel);
+    const float scale = alpha != 0 ? 255.0f / static_cast<float>(alpha) : 0.0f;
+    auto straight     = [scale](int code)
+    { return std::min(static_cast<int>(static_cast<float>(code) * scale + 0.5f), 255); };
+    return qRgba(straight(qRed(pixel)), straight(qGreen(pixel)), straight(qBlue(pixel)), alpha);
+}
+
+// code * alpha / 255 rounded to nearest, as qPremultiply computes it
+inline int premultiplied(int code, int alpha)
+{
+    const int product = code * alpha;
+    return (product + (product >> 8) + 0x80) >> 8;
+}
+
+template <int Variant>
+void convertRow(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width)
+{
+    constexpr bool KeepSaturation = (Variant & ConversionKernels::KeepSaturationStage) != 0;
+    constexpr bool LinearSource   = (Variant & ConversionKernels::LinearSourceStage) != 0;
+    constexpr bool LinearTarget   = (Variant & ConversionKernels::LinearTargetStage) != 0;
+    constexpr bool WriteMask      = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay        = (Variant & ConversionKernels::OverlayStage) != 0;
+    constexpr bool KeepAlpha      = (Variant & ConversionKernels::AlphaStage) != 0;
+    constexpr bool Premultiplied  = (Variant & ConversionKernels::PremultipliedStage) != 0;
+
+    const float *decode = parameters.decodeLut;
+    const uchar *encode = parameters.encodeLut;
+    const float *m      = parameters.matrix;
+
+    uchar maskByte = 0;
+    for (int x = 0; x < width; ++x)
+    {
+        const QRgb pixel = Premultiplied ? unpremultiplied(source[x]) : source[x];
+        const float r    = decodeChannel<LinearSource>(decode, qRed(pixel));
+        const float g    = decodeChannel<LinearSource>(decode, qGreen(pixel));
+        const float b    = decodeChannel<LinearSource>(decode, qBlue(pixel));
+
+        const float targetR = m[0] * r + m[1] * g + m[2] * b;
+        const float targetG = m[3] * r + m[4] * g + m[5] * b;
+        const float targetB = m[6] * r + m[7] * g + m[8] * b;
+
+        bool outOfGamut = false;
+        if constexpr (WriteMask || Overlay)
+        {
+            outOfGamut = targetR < -ColorTransform::OutOfGamutEpsilon || targetG < -ColorTransform::OutOfGamutEpsilon ||
+                         targetB < -ColorTransform::OutOfGamutEpsilon ||
+                         targetR > 1.0f + ColorTransform::OutOfGamutEpsilon ||
+                         targetG > 1.0f + ColorTransform::OutOfGamutEpsilon ||
+                         targetB > 1.0f + ColorTransform::OutOfGamutEpsilon;
+        }
+        if constexpr (WriteMask)
+        {
+            maskByte |= static_cast<uchar>(outOfGamut) << (x & 7);
+            if ((x & 7) == 7)
+            {
+                mask[x >> 3] = maskByte;
+                maskByte     = 0;
+            }
+        }
+
+        const uchar codeR = encodeChannel<LinearTarget>(encode, parameters.encodeRoots, targetR);
+        const uchar codeG = encodeChannel<LinearTarget>(encode, parameters.encodeRoots, targetG);
+        const uchar codeB = encodeChannel<LinearTarget>(encode, parameters.encodeRoots, targetB);
+        QRgb encoded;
+        if constexpr (KeepSaturation)
+        {
+            encoded = keepSaturation(pixel, codeR, codeG, codeB);
+        }
+        else
+        {
+            encoded = qRgb(codeR, codeG, codeB);
+        }
+        if constexpr (Premultiplied)
+        {
+            const int alpha = qAlpha(pixel);
+            encoded         = qRgba(
+                premultiplied(qRed(encoded), alpha), premultiplied(qGreen(encoded), alpha),
+                premultiplied(qBlue(encoded), alpha), alpha
+            );
+        }
+        else if constexpr (KeepAlpha)
+        {
+            encoded = (encoded & 0x00ffffff) | (pixel & 0xff000000);
+        }
+        target[x] = Overlay && outOfGamut ? ColorTransform::OverlayPixel : encoded;
+    }
+    if (WriteMask && (width & 7) != 0)
+    {
+        mask[width >> 3] = maskByte;
+    }
+}
+
+// Channels of a wide row as values in [0, 1] and back
+inline float unit(float value)
+{
+    // Written so that NaN ends up at 0 as well
+    return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+}
+
+inline float normalized(quint16 channel)
+{
+    return unit(static_cast<float>(channel) * (1.0f / 65535.0f));
+}
+
+inline float normalized(float channel)
+{
+    return unit(channel);
+}
+
+template <typename Channel>
+Channel denormalized(float value)
+{
+    if constexpr (std::is_same_v<Channel, quint16>)
+    {
+        return static_cast<quint16>(static_cast<int>(value * 65535.0f + 0.5f));
+    }
+    return value;
+}
+
+template <typename Channel>
+constexpr Channel FullChannel = std::is_same_v<Channel, quint16> ? Channel(65535) : Channel(1);
+
+// keepSaturation on values in [0, 1]; the floor on the denominator stands in for one 16-bit step
+void keepSaturationWide(const float source[3], float &r, float &g, float &b)
+{
+    const float sourceMax = std::max(std::max(source[0], source[1]), source[2]);
+    const float sourceMin = std::min(std::min(source[0], source[1]), source[2]);
+    const float targetMax = std::max(std::max(r, g), b);
+    const float targetMin = std::min(std::min(r, g), b);
+
+    const float sourceRange = 1.0f - std::abs(sourceMax + sourceMin - 1.0f);
+    const float targetRange = 1.0f - std::abs(targetMax + targetMin - 1.0f);
+    const float scale       = (sourceMax - sourceMin) * targetRange /
+                        std::max(sourceRange * (targetMax - targetMin), 1.0f / (65535.0f * 65535.0f));
+    const float lightness   = (targetMax + targetMin) * 0.5f;
+
+    auto adjust = [&](float channel) { return unit(lightness + (channel - lightness) * scale); };
+    r           = adjust(r);
+    g           = adjust(g);
+    b           = adjust(b);
+}
+
+template <typename Channel, int Variant>
+void convertWideRow(const KernelParameters &parameters, const Channel *source, Channel *target, uchar *mask, int width)
+{
+    constexpr bool KeepSaturation = (Variant & ConversionKernels::KeepSaturationStage) != 0;
+    constexpr bool LinearSource   = (Variant & ConversionKernels::LinearSourceStage) != 0;
+    constexpr bool LinearTarget   = (Variant & ConversionKernels::LinearTargetStage) != 0;
+    constexpr bool WriteMask      = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay        = (Variant & ConversionKernels::OverlayStage) != 0;
+
+    const float *m = parameters.matrix;
+    auto decode    = [&](float value)
+    {
+        if constexpr (LinearSource)
+        {
+            return value;
+        }
+        return TransferFunction::interpolate(parameters.wideDecodeLut, TransferFunction::WideDecodeSize, value);
+    };
+    auto encode = [&](float linear)
+    {
+        if constexpr (LinearTarget)
+        {
+            return unit(linear);
+        }
+        return TransferFunction::interpolate(
+            parameters.wideEncodeLut, TransferFunction::WideEncodeSize, std::sqrt(unit(linear))
+        );
+    };
+
+    uchar maskByte = 0;
+    for (int x = 0; x < width; ++x)
+    {
+        const Channel *pixel = source + 4 * x;
+        const float encoded[3] = {normalized(pixel[0]), normalized(pixel[1]), normalized(pixel[2])};
+        const Channel alpha    = pixel[3];
+        const float r          = decode(encoded[0]);
+        const float g          = decode(encoded[1]);
+        const float b          = decode(encoded[2]);
+
+        const float targetR = m[0] * r + m[1] * g + m[2] * b;
+        const float targetG = m[3] * r + m[4] * g + m[5] * b;
+        const float targetB = m[6] * r + m[7] * g + m[8] * b;
+
+        bool outOfGamut = false;
+        if constexpr (WriteMask || Overlay)
+        {
+            outOfGamut = targetR < -ColorTransform::OutOfGamutEpsilon || targetG < -ColorTransform::OutOfGamutEpsilon ||
+                         targetB < -ColorTransform::OutOfGamutEpsilon ||
+                         targetR > 1.0f + ColorTransform::OutOfGamutEpsilon ||
+                         targetG > 1.0f + ColorTransform::OutOfGamutEpsilon ||
+                         targetB > 1.0f + ColorTransform::OutOfGamutEpsilon;
+        }
+        if constexpr (WriteMask)
+        {
+            maskByte |= static_cast<uchar>(outOfGamut) << (x & 7);
+            if ((x & 7) == 7)
+            {
+                mask[x >> 3] = maskByte;
+                maskByte     = 0;
+            }
+        }
+
+        Channel *out = target + 4 * x;
+        if (Overlay && outOfGamut)
+        {
+            out[0] = FullChannel<Channel>;
+            out[1] = Channel(0);
+            out[2] = FullChannel<Channel>;
+            out[3] = FullChannel<Channel>;
+            continue;
+        }
+
+        float valueR = encode(targetR);
+        float valueG = encode(targetG);
+        float valueB = encode(targetB);
+        if constexpr (KeepSaturation)
+        {
+            keepSaturationWide(encoded, valueR, valueG, valueB);
+        }
+        out[0] = denormalized<Channel>(valueR);
+        out[1] = denormalized<Channel>(valueG);
+        out[2] = denormalized<Channel>(valueB);
+        out[3] = alpha;
+    }
+    if (WriteMask && (width & 7) != 0)
+    {
+        mask[width >> 3] = maskByte;
+    }
+}
+
+template <typename Channel>
+using WideRowKernel =
+    void (*)(const KernelParameters &parameters, const Channel *source, Channel *target, uchar *mask, int width);
+
+template <typename Channel>
+using WideKernelTable = ConversionKernels::KernelTable<WideRowKernel<Channel>, ConversionKernels::WideVariantCount>;
+
+template <typename Channel, int... Variants>
+constexpr WideKernelTable<Channel> makeWideKernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertWideRow<Channel, Variants>...}};
+}
+
+constexpr WideKernelTable<quint16> scalarRgba64Kernels =
+    makeWideKernelTable<quint16>(std::make_integer_sequence<int, ConversionKernels::WideVariantCount>());
+constexpr WideKernelTable<float> scalarRgbaFloatKernels =
+    makeWideKernelTable<float>(std::make_integer_sequence<int, ConversionKernels::WideVariantCount>());
+
+template <int... Variants>
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel>
+makeKernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertRow<Variants>...}};
+}
+
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel> scalarKernels =
+    makeKernelTable(std::make_integer_sequence<int, ConversionKernels::VariantCount>());
+} // namespace
+
+ConversionKernels::InstructionSet ConversionKernels::bestInstructionSet()
+{
+    static const InstructionSet best = detectInstructionSet();
+    return best;
+}
+
+bool ConversionKernels::isSupported(InstructionSet instructionSet)
+{
+    return static_cast<int>(instructionSet) <= static_cast<int>(bestInstructionSet());
+}
+
+ConversionKernels::RowKernel ConversionKernels::kernel(InstructionSet instructionSet)
+{
+    if (!isSupported(instructionSet))
+    {
+        return nullptr;
+    }
+
+    switch (instructionSet)
+    {
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+    case InstructionSet::SSE41:
+        return &convertRowSSE41;
+    case InstructionSet::AVX2:
+        return &convertRowAVX2;
+    case InstructionSet::AVX512:
+        return &convertRowAVX512;
+#endif
+    default:
+        return &convertRowScalar;
+    }
+}
+
+ConversionKernels::Rgba64RowKernel ConversionKernels::rgba64Kernel(InstructionSet instructionSet)
+{
+    if (!isSupported(instructionSet))
+    {
+        return nullptr;
+    }
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+    if (instructionSet >= InstructionSet::AVX2)
+    {
+        return &convertRgba64RowAVX2;
+    }
+#endif
+    return &convertRgba64RowScalar;
+}
+
+ConversionKernels::RgbaFloatRowKernel ConversionKernels::rgbaFloatKernel(InstructionSet instructionSet)
+{
+    if (!isSupported(instructionSet))
+    {
+        return nullptr;
+    }
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+    if (instructionSet >= InstructionSet::AVX2)
+    {
+        return &convertRgbaFloatRowAVX2;
+    }
+#endif
+    return &convertRgbaFloatRowScalar;
+}
+
+const char *ConversionKernels::name(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case InstructionSet::SSE41:
+        return "SSE4.1";
+    case InstructionSet::AVX2:
+        return "AVX2";
+    case InstructionSet::AVX512:
+        return "AVX-512";
+    default:
+        return "Scalar";
+    }
+}
+
+ConversionKernels::InstructionSet ConversionKernels::detectInstructionSet()
+{
+#if defined(IMAGEPROFILECONVERTER_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return InstructionSet::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return InstructionSet::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return InstructionSet::SSE41;
+    }
+#elif defined(IMAGEPROFILECONVERTER_X86_KERNELS) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse41   = (info[2] & (1 << 19)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+
+    // The OS has to save the wider registers as well, not only the CPU support them
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool ymmEnabled         = (xcr0 & 0x6) == 0x6;
+    const bool zmmEnabled         = (xcr0 & 0xe6) == 0xe6;
+
+    bool avx2    = false;
+    bool avx512f = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2    = (info[1] & (1 << 5)) != 0;
+        avx512f = (info[1] & (1 << 16)) != 0;
+    }
+
+    if (avx512f && zmmEnabled)
+    {
+        return InstructionSet::AVX512;
+    }
+    if (avx && avx2 && ymmEnabled)
+    {
+        return InstructionSet::AVX2;
+    }
+    if (sse41)
+    {
+        return InstructionSet::SSE41;
+    }
+#endif
+    return InstructionSet::Scalar;
+}
+
+int ConversionKernels::variant(const KernelParameters &parameters, bool writeMask)
+{
+    return (parameters.keepSaturation ? KeepSaturationStage : 0) | (parameters.linearSource ? LinearSourceStage : 0) |
+           (parameters.linearTarget ? LinearTargetStage : 0) | (writeMask ? MaskStage : 0) |
+           (parameters.overlayOutOfGamut ? OverlayStage : 0) |
+           (parameters.premultiplied ? PremultipliedStage : (parameters.keepAlpha ? AlphaStage : 0));
+}
+
+void ConversionKernels::convertRowScalar(
+    const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width
+)
+{
+    scalarKernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+void ConversionKernels::convertRgba64RowScalar(
+    const KernelParameters &parameters, const quint16 *source, quint16 *target, uchar *mask, int width
+)
+{
+    scalarRgba64Kernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+void ConversionKernels::convertRgbaFloatRowScalar(
+    const KernelParameters &parameters, const float *source, float *target, uchar *mask, int width
+)
+{
+    scalarRgbaFloatKernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
@@ -0,0 +1,510 @@
+#include "ColorTransform.h"
+#include "ConversionKernels.h"
+#include "TransferFunction.h"
+
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+#include <immintrin.h>
+#include <utility>
+
+namespace
+{
+template <bool Linear>
+inline __m256 decodeLanes(const float *lut, __m256i indices)
+{
+    if constexpr (Linear)
+    {
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(indices), _mm256_set1_ps(1.0f / 255.0f));
+    }
+    return _mm256_i32gather_ps(lut, indices, 4);
+}
+
+template <bool Linear>
+inline __m256i encodeLanes(const uchar *lut, int roots, __m256 linear)
+{
+    // max returns its second operand for NaN, so NaN clamps to 0 like in the scalar kernel
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(linear, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    if constexpr (Linear)
+    {
+        return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+    }
+    __m256 root = clamped;
+    for (int i = 0; i < roots; ++i)
+    {
+        root = _mm256_sqrt_ps(root);
+    }
+    const __m256 scaled  = _mm256_add_ps(
+        _mm256_mul_ps(root, _mm256_set1_ps(float(TransferFunction::EncodeSize - 1))), _mm256_set1_ps(0.5f)
+    );
+    // Gathers a 32-bit word at each byte index, the encode table is padded for the bytes read past the end
+    const __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int *>(lut), _mm256_cvttps_epi32(scaled), 1);
+    return _mm256_and_si256(words, _mm256_set1_epi32(0xff));
+}
+
+inline __m256 absolute(__m256 value)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+}
+
+// Same steps as the scalar keepSaturation, on eight pixels of codes
+inline void keepSaturation(__m256i pixels, __m256i &r, __m256i &g, __m256i &b)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256 sourceR   = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), byteMask));
+    const __m256 sourceG   = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), byteMask));
+    const __m256 sourceB   = _mm256_cvtepi32_ps(_mm256_and_si256(pixels, byteMask));
+    const __m256 targetR   = _mm256_cvtepi32_ps(r);
+    const __m256 targetG   = _mm256_cvtepi32_ps(g);
+    const __m256 targetB   = _mm256_cvtepi32_ps(b);
+
+    const __m256 sourceMax = _mm256_max_ps(_mm256_max_ps(sourceR, sourceG), sourceB);
+    const __m256 sourceMin = _mm256_min_ps(_mm256_min_ps(sourceR, sourceG), sourceB);
+    const __m256 targetMax = _mm256_max_ps(_mm256_max_ps(targetR, targetG), targetB);
+    const __m256 targetMin = _mm256_min_ps(_mm256_min_ps(targetR, targetG), targetB);
+
+    const __m256 full = _mm256_set1_ps(255.0f);
+    const __m256 sourceRange =
+        _mm256_sub_ps(full, absolute(_mm256_sub_ps(_mm256_add_ps(sourceMax, sourceMin), full)));
+    const __m256 targetRange =
+        _mm256_sub_ps(full, absolute(_mm256_sub_ps(_mm256_add_ps(targetMax, targetMin), full)));
+    const __m256 scale = _mm256_div_ps(
+        _mm256_mul_ps(_mm256_sub_ps(sourceMax, sourceMin), targetRange),
+        _mm256_max_ps(_mm256_mul_ps(sourceRange, _mm256_sub_ps(targetMax, targetMin)), _mm256_set1_ps(1.0f))
+    );
+    const __m256 lightness = _mm256_mul_ps(_mm256_add_ps(targetMax, targetMin), _mm256_set1_ps(0.5f));
+
+    auto adjust = [&](__m256 channel)
+    {
+        const __m256 value   = _mm256_add_ps(lightness, _mm256_mul_ps(_mm256_sub_ps(channel, lightness), scale));
+        const __m256 clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), full);
+        return _mm256_cvttps_epi32(_mm256_add_ps(clamped, _mm256_set1_ps(0.5f)));
+    };
+    r = adjust(targetR);
+    g = adjust(targetG);
+    b = adjust(targetB);
+}
+
+// Same steps as the scalar unpremultiplied, on eight pixels; alpha stays in the top byte
+inline __m256i unpremultiply(__m256i pixels)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256 alpha     = _mm256_cvtepi32_ps(_mm256_srli_epi32(pixels, 24));
+    // 255 / 0 is infinity, the comparison turns the scale to 0 for transparent pixels
+    const __m256 scale = _mm256_and_ps(
+        _mm256_div_ps(_mm256_set1_ps(255.0f), alpha), _mm256_cmp_ps(alpha, _mm256_setzero_ps(), _CMP_NEQ_OQ)
+    );
+    auto straight = [&](__m256i code)
+    {
+        const __m256 scaled = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(code), scale), _mm256_set1_ps(0.5f));
+        return _mm256_min_epi32(_mm256_cvttps_epi32(scaled), byteMask);
+    };
+    const __m256i r = straight(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), byteMask));
+    const __m256i g = straight(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), byteMask));
+    const __m256i b = straight(_mm256_and_si256(pixels, byteMask));
+    const __m256i straightPixels =
+        _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+    return _mm256_or_si256(_mm256_and_si256(pixels, _mm256_set1_epi32(static_cast<int>(0xff000000))), straightPixels);
+}
+
+// Same integer steps as the scalar premultiplied
+inline __m256i premultiply(__m256i code, __m256i alpha)
+{
+    const __m256i product = _mm256_mullo_epi32(code, alpha);
+    return _mm256_srli_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(product, _mm256_srli_epi32(product, 8)), _mm256_set1_epi32(0x80)), 8
+    );
+}
+
+template <int Variant>
+void convertRow(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width)
+{
+    constexpr bool KeepSaturation = (Variant & ConversionKernels::KeepSaturationStage) != 0;
+    constexpr bool LinearSource   = (Variant & ConversionKernels::LinearSourceStage) != 0;
+    constexpr bool LinearTarget   = (Variant & ConversionKernels::LinearTargetStage) != 0;
+    constexpr bool WriteMask      = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay        = (Variant & ConversionKernels::OverlayStage) != 0;
+    constexpr bool KeepAlpha      = (Variant & ConversionKernels::AlphaStage) != 0;
+    constexpr bool Premultiplied  = (Variant & ConversionKernels::PremultipliedStage) != 0;
+
+    const float *m = parameters.matrix;
+    const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+    const __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+    const __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+
+    const __m256 lowerBound    = _mm256_set1_ps(-ColorTransform::OutOfGamutEpsilon);
+    const __m256 upperBound    = _mm256_set1_ps(1.0f + ColorTransform::OutOfGamutEpsilon);
+    const __m256i byteMask     = _mm256_set1_epi32(0xff);
+    const __m256i alphaMask    = _mm256_set1_epi32(static_cast<int>(0xff000000));
+    const __m256i overlayPixel = _mm256_set1_epi32(static_cast<int>(ColorTransform::OverlayPixel));
+    const float *decode        = parameters.decodeLut;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + x));
+        if constexpr (Premultiplied)
+        {
+            pixels = unpremultiply(pixels);
+        }
+        const __m256 r = decodeLanes<LinearSource>(decode, _mm256_and_si256(_mm256_srli_epi32(pixels, 16), byteMask));
+        const __m256 g = decodeLanes<LinearSource>(decode, _mm256_and_si256(_mm256_srli_epi32(pixels, 8), byteMask));
+        const __m256 b = decodeLanes<LinearSource>(decode, _mm256_and_si256(pixels, byteMask));
+
+        // Same evaluation order as the scalar kernel so results match bit for bit
+        const __m256 targetR =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, r), _mm256_mul_ps(m1, g)), _mm256_mul_ps(m2, b));
+        const __m256 targetG =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m3, r), _mm256_mul_ps(m4, g)), _mm256_mul_ps(m5, b));
+        const __m256 targetB =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m6, r), _mm256_mul_ps(m7, g)), _mm256_mul_ps(m8, b));
+
+        __m256 outOfGamut = _mm256_setzero_ps();
+        if constexpr (WriteMask || Overlay)
+        {
+            outOfGamut = _mm256_or_ps(
+                _mm256_cmp_ps(targetR, lowerBound, _CMP_LT_OQ), _mm256_cmp_ps(targetR, upperBound, _CMP_GT_OQ)
+            );
+            outOfGamut = _mm256_or_ps(
+                outOfGamut,
+                _mm256_or_ps(
+                    _mm256_cmp_ps(targetG, lowerBound, _CMP_LT_OQ), _mm256_cmp_ps(targetG, upperBound, _CMP_GT_OQ)
+                )
+            );
+            outOfGamut = _mm256_or_ps(
+                outOfGamut,
+                _mm256_or_ps(
+                    _mm256_cmp_ps(targetB, lowerBound, _CMP_LT_OQ), _mm256_cmp_ps(targetB, upperBound, _CMP_GT_OQ)
+                )
+            );
+        }
+        if constexpr (WriteMask)
+        {
+            mask[x >> 3] = static_cast<uchar>(_mm256_movemask_ps(outOfGamut));
+        }
+
+        __m256i codeR = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetR);
+        __m256i codeG = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetG);
+        __m256i codeB = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetB);
+        if constexpr (KeepSaturation)
+        {
+            keepSaturation(pixels, codeR, codeG, codeB);
+        }
+        if constexpr (Premultiplied)
+        {
+            const __m256i alphaCodes = _mm256_srli_epi32(pixels, 24);
+            codeR                    = premultiply(codeR, alphaCodes);
+            codeG                    = premultiply(codeG, alphaCodes);
+            codeB                    = premultiply(codeB, alphaCodes);
+        }
+
+        const __m256i alpha = KeepAlpha || Premultiplied ? _mm256_and_si256(pixels, alphaMask) : alphaMask;
+        __m256i encoded     = _mm256_or_si256(alpha, _mm256_slli_epi32(codeR, 16));
+        encoded         = _mm256_or_si256(encoded, _mm256_slli_epi32(codeG, 8));
+        encoded         = _mm256_or_si256(encoded, codeB);
+        if constexpr (Overlay)
+        {
+            encoded = _mm256_blendv_epi8(encoded, overlayPixel, _mm256_castps_si256(outOfGamut));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(target + x), encoded);
+    }
+
+    ConversionKernels::convertRowScalar(
+        parameters, source + x, target + x, WriteMask ? mask + (x >> 3) : nullptr, width - x
+    );
+}
+
+// Wide rows: channels as values in [0, 1], the same steps as the scalar wide kernels
+inline __m256 unitLanes(__m256 value)
+{
+    // max returns its second operand for NaN, so NaN clamps to 0 like in the scalar kernels
+    return _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+// TransferFunction::interpolate for values already in [0, 1]
+inline __m256 interpolateLanes(const float *table, int size, __m256 value)
+{
+    const __m256 position = _mm256_mul_ps(value, _mm256_set1_ps(static_cast<float>(size)));
+    const __m256i index   = _mm256_min_epi32(_mm256_cvttps_epi32(position), _mm256_set1_epi32(size - 1));
+    const __m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(index));
+    const __m256 low      = _mm256_i32gather_ps(table, index, 4);
+    const __m256 high     = _mm256_i32gather_ps(table + 1, index, 4);
+    return _mm256_add_ps(low, _mm256_mul_ps(_mm256_sub_ps(high, low), fraction));
+}
+
+// Same steps as the scalar keepSaturationWide
+inline void keepSaturationWide(__m256 sourceR, __m256 sourceG, __m256 sourceB, __m256 &r, __m256 &g, __m256 &b)
+{
+    const __m256 sourceMax = _mm256_max_ps(_mm256_max_ps(sourceR, sourceG), sourceB);
+    const __m256 sourceMin = _mm256_min_ps(_mm256_min_ps(sourceR, sourceG), sourceB);
+    const __m256 targetMax = _mm256_max_ps(_mm256_max_ps(r, g), b);
+    const __m256 targetMin = _mm256_min_ps(_mm256_min_ps(r, g), b);
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 sourceRange =
+        _mm256_sub_ps(one, absolute(_mm256_sub_ps(_mm256_add_ps(sourceMax, sourceMin), one)));
+    const __m256 targetRange =
+        _mm256_sub_ps(one, absolute(_mm256_sub_ps(_mm256_add_ps(targetMax, targetMin), one)));
+    const __m256 scale = _mm256_div_ps(
+        _mm256_mul_ps(_mm256_sub_ps(sourceMax, sourceMin), targetRange),
+        _mm256_max_ps(
+            _mm256_mul_ps(sourceRange, _mm256_sub_ps(targetMax, targetMin)),
+            _mm256_set1_ps(1.0f / (65535.0f * 65535.0f))
+        )
+    );
+    const __m256 lightness = _mm256_mul_ps(_mm256_add_ps(targetMax, targetMin), _mm256_set1_ps(0.5f));
+
+    auto adjust = [&](__m256 channel)
+    { return unitLanes(_mm256_add_ps(lightness, _mm256_mul_ps(_mm256_sub_ps(channel, lightness), scale))); };
+    r = adjust(r);
+    g = adjust(g);
+    b = adjust(b);
+}
+
+// Converts eight pixels of source values in r, g and b to target values in place and returns the out-of-gamut lanes
+template <int Variant>
+inline __m256 convertWideLanes(const KernelParameters &parameters, const __m256 m[9], __m256 &r, __m256 &g, __m256 &b)
+{
+    constexpr bool KeepSaturation = (Variant & ConversionKernels::KeepSaturationStage) != 0;
+    constexpr bool LinearSource   = (Variant & ConversionKernels::LinearSourceStage) != 0;
+    constexpr bool LinearTarget   = (Variant & ConversionKernels::LinearTargetStage) != 0;
+    constexpr bool TestGamut      = (Variant & (ConversionKernels::MaskStage | ConversionKernels::OverlayStage)) != 0;
+
+    const __m256 sourceR = r, sourceG = g, sourceB = b;
+    if constexpr (!LinearSource)
+    {
+        r = interpolateLanes(parameters.wideDecodeLut, TransferFunction::WideDecodeSize, r);
+        g = interpolateLanes(parameters.wideDecodeLut, TransferFunction::WideDecodeSize, g);
+        b = interpolateLanes(parameters.wideDecodeLut, TransferFunction::WideDecodeSize, b);
+    }
+
+    // Same evaluation order as the scalar kernel so results match bit for bit
+    const __m256 targetR =
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0], r), _mm256_mul_ps(m[1], g)), _mm256_mul_ps(m[2], b));
+    const __m256 targetG =
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[3], r), _mm256_mul_ps(m[4], g)), _mm256_mul_ps(m[5], b));
+    const __m256 targetB =
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[6], r), _mm256_mul_ps(m[7], g)), _mm256_mul_ps(m[8], b));
+
+    __m256 outOfGamut = _mm256_setzero_ps();
+    if constexpr (TestGamut)
+    {
+        const __m256 lowerBound = _mm256_set1_ps(-ColorTransform::OutOfGamutEpsilon);
+        const __m256 upperBound = _mm256_set1_ps(1.0f + ColorTransform::OutOfGamutEpsilon);
+        for (__m256 channel : {targetR, targetG, targetB})
+        {
+            outOfGamut = _mm256_or_ps(
+                outOfGamut, _mm256_or_ps(
+                                _mm256_cmp_ps(channel, lowerBound, _CMP_LT_OQ),
+                                _mm256_cmp_ps(channel, upperBound, _CMP_GT_OQ)
+                            )
+            );
+        }
+    }
+
+    r = unitLanes(targetR);
+    g = unitLanes(targetG);
+    b = unitLanes(targetB);
+    if constexpr (!LinearTarget)
+    {
+        r = interpolateLanes(parameters.wideEncodeLut, TransferFunction::WideEncodeSize, _mm256_sqrt_ps(r));
+        g = interpolateLanes(parameters.wideEncodeLut, TransferFunction::WideEncodeSize, _mm256_sqrt_ps(g));
+        b = interpolateLanes(parameters.wideEncodeLut, TransferFunction::WideEncodeSize, _mm256_sqrt_ps(b));
+    }
+    if constexpr (KeepSaturation)
+    {
+        keepSaturationWide(sourceR, sourceG, sourceB, r, g, b);
+    }
+    return outOfGamut;
+}
+
+template <int Variant>
+void convertRgba64Row(
+    const KernelParameters &parameters, const quint16 *source, quint16 *target, uchar *mask, int width
+)
+{
+    constexpr bool WriteMask = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay   = (Variant & ConversionKernels::OverlayStage) != 0;
+
+    __m256 m[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        m[i] = _mm256_set1_ps(parameters.matrix[i]);
+    }
+    const __m256i wordMask = _mm256_set1_epi32(0xffff);
+    const __m256i evenOdd  = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256 toUnit    = _mm256_set1_ps(1.0f / 65535.0f);
+    const __m256 full      = _mm256_set1_ps(65535.0f);
+    const __m256i fullCode = _mm256_set1_epi32(0xffff);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        // A pixel is two 32-bit words, red | green << 16 and blue | alpha << 16; split them into eight of each
+        const __m256i first  = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + 4 * x)), evenOdd
+        );
+        const __m256i second = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + 4 * x + 16)), evenOdd
+        );
+        const __m256i redGreen  = _mm256_permute2x128_si256(first, second, 0x20);
+        const __m256i blueAlpha = _mm256_permute2x128_si256(first, second, 0x31);
+
+        __m256 r = unitLanes(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(redGreen, wordMask)), toUnit));
+        __m256 g = unitLanes(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(redGreen, 16)), toUnit));
+        __m256 b = unitLanes(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(blueAlpha, wordMask)), toUnit));
+        const __m256 outOfGamut = convertWideLanes<Variant>(parameters, m, r, g, b);
+        if constexpr (WriteMask)
+        {
+            mask[x >> 3] = static_cast<uchar>(_mm256_movemask_ps(outOfGamut));
+        }
+
+        const __m256 half = _mm256_set1_ps(0.5f);
+        __m256i codeR     = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(r, full), half));
+        __m256i codeG     = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(g, full), half));
+        __m256i codeB     = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(b, full), half));
+        __m256i alpha     = _mm256_srli_epi32(blueAlpha, 16);
+        if constexpr (Overlay)
+        {
+            const __m256i lanes = _mm256_castps_si256(outOfGamut);
+            codeR               = _mm256_blendv_epi8(codeR, fullCode, lanes);
+            codeG               = _mm256_andnot_si256(lanes, codeG);
+            codeB               = _mm256_blendv_epi8(codeB, fullCode, lanes);
+            alpha               = _mm256_blendv_epi8(alpha, fullCode, lanes);
+        }
+
+        const __m256i outRedGreen  = _mm256_or_si256(codeR, _mm256_slli_epi32(codeG, 16));
+        const __m256i outBlueAlpha = _mm256_or_si256(codeB, _mm256_slli_epi32(alpha, 16));
+        const __m256i low          = _mm256_unpacklo_epi32(outRedGreen, outBlueAlpha);
+        const __m256i high         = _mm256_unpackhi_epi32(outRedGreen, outBlueAlpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(target + 4 * x), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(target + 4 * x + 16), _mm256_permute2x128_si256(low, high, 0x31)
+        );
+    }
+
+    ConversionKernels::convertRgba64RowScalar(
+        parameters, source + 4 * x, target + 4 * x, WriteMask ? mask + (x >> 3) : nullptr, width - x
+    );
+}
+
+// Four pixels in four registers to four channels, or back; register i holds pixels i and i + 4
+inline void transpose(__m256 &v0, __m256 &v1, __m256 &v2, __m256 &v3)
+{
+    const __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+    const __m256 t1 = _mm256_unpackhi_ps(v0, v1);
+    const __m256 t2 = _mm256_unpacklo_ps(v2, v3);
+    const __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+    v0              = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    v1              = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    v2              = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    v3              = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+template <int Variant>
+void convertRgbaFloatRow(const KernelParameters &parameters, const float *source, float *target, uchar *mask, int width)
+{
+    constexpr bool WriteMask = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay   = (Variant & ConversionKernels::OverlayStage) != 0;
+
+    __m256 m[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        m[i] = _mm256_set1_ps(parameters.matrix[i]);
+    }
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const float *pixels = source + 4 * x;
+        auto load           = [&](int pixel)
+        {
+            return _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm_loadu_ps(pixels + 4 * pixel)), _mm_loadu_ps(pixels + 4 * (pixel + 4)), 1
+            );
+        };
+        __m256 r = load(0), g = load(1), b = load(2), alpha = load(3);
+        transpose(r, g, b, alpha);
+
+        r                       = unitLanes(r);
+        g                       = unitLanes(g);
+        b                       = unitLanes(b);
+        const __m256 outOfGamut = convertWideLanes<Variant>(parameters, m, r, g, b);
+        if constexpr (WriteMask)
+        {
+            mask[x >> 3] = static_cast<uchar>(_mm256_movemask_ps(outOfGamut));
+        }
+        if constexpr (Overlay)
+        {
+            r     = _mm256_blendv_ps(r, one, outOfGamut);
+            g     = _mm256_andnot_ps(outOfGamut, g);
+            b     = _mm256_blendv_ps(b, one, outOfGamut);
+            alpha = _mm256_blendv_ps(alpha, one, outOfGamut);
+        }
+
+        transpose(r, g, b, alpha);
+        float *out = target + 4 * x;
+        int pixel  = 0;
+        for (__m256 value : {r, g, b, alpha})
+        {
+            _mm_storeu_ps(out + 4 * pixel, _mm256_castps256_ps128(value));
+            _mm_storeu_ps(out + 4 * (pixel + 4), _mm256_extractf128_ps(value, 1));
+            ++pixel;
+        }
+    }
+
+    ConversionKernels::convertRgbaFloatRowScalar(
+        parameters, source + 4 * x, target + 4 * x, WriteMask ? mask + (x >> 3) : nullptr, width - x
+    );
+}
+
+template <int... Variants>
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel>
+makeKernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertRow<Variants>...}};
+}
+
+template <int... Variants>
+constexpr ConversionKernels::KernelTable<ConversionKernels::Rgba64RowKernel, ConversionKernels::WideVariantCount>
+makeRgba64KernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertRgba64Row<Variants>...}};
+}
+
+template <int... Variants>
+constexpr ConversionKernels::KernelTable<ConversionKernels::RgbaFloatRowKernel, ConversionKernels::WideVariantCount>
+makeRgbaFloatKernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertRgbaFloatRow<Variants>...}};
+}
+
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel> avx2Kernels =
+    makeKernelTable(std::make_integer_sequence<int, ConversionKernels::VariantCount>());
+constexpr auto avx2Rgba64Kernels =
+    makeRgba64KernelTable(std::make_integer_sequence<int, ConversionKernels::WideVariantCount>());
+constexpr auto avx2RgbaFloatKernels =
+    makeRgbaFloatKernelTable(std::make_integer_sequence<int, ConversionKernels::WideVariantCount>());
+} // namespace
+
+void ConversionKernels::convertRowAVX2(
+    const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width
+)
+{
+    avx2Kernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+void ConversionKernels::convertRgba64RowAVX2(
+    const KernelParameters &parameters, const quint16 *source, quint16 *target, uchar *mask, int width
+)
+{
+    avx2Rgba64Kernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+void ConversionKernels::convertRgbaFloatRowAVX2(
+    const KernelParameters &parameters, const float *source, float *target, uchar *mask, int width
+)
+{
+    avx2RgbaFloatKernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+#endif // IMAGEPROFILECONVERTER_X86_KERNELS
@@ -0,0 +1,221 @@
+#include "ColorTransform.h"
+#include "ConversionKernels.h"
+#include "TransferFunction.h"
+
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+#include <immintrin.h>
+#include <utility>
+
+namespace
+{
+template <bool Linear>
+inline __m512 decodeLanes(const float *lut, __m512i indices)
+{
+    if constexpr (Linear)
+    {
+        return _mm512_mul_ps(_mm512_cvtepi32_ps(indices), _mm512_set1_ps(1.0f / 255.0f));
+    }
+    return _mm512_i32gather_ps(indices, lut, 4);
+}
+
+template <bool Linear>
+inline __m512i encodeLanes(const uchar *lut, int roots, __m512 linear)
+{
+    // max returns its second operand for NaN, so NaN clamps to 0 like in the scalar kernel
+    const __m512 clamped = _mm512_min_ps(_mm512_max_ps(linear, _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+    if constexpr (Linear)
+    {
+        return _mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(clamped, _mm512_set1_ps(255.0f)), _mm512_set1_ps(0.5f)));
+    }
+    __m512 root = clamped;
+    for (int i = 0; i < roots; ++i)
+    {
+        root = _mm512_sqrt_ps(root);
+    }
+    const __m512 scaled  = _mm512_add_ps(
+        _mm512_mul_ps(root, _mm512_set1_ps(float(TransferFunction::EncodeSize - 1))), _mm512_set1_ps(0.5f)
+    );
+    // Gathers a 32-bit word at each byte index, the encode table is padded for the bytes read past the end
+    const __m512i words = _mm512_i32gather_epi32(_mm512_cvttps_epi32(scaled), lut, 1);
+    return _mm512_and_si512(words, _mm512_set1_epi32(0xff));
+}
+
+inline __mmask16 outOfRange(__m512 value, __m512 lowerBound, __m512 upperBound)
+{
+    return _mm512_cmp_ps_mask(value, lowerBound, _CMP_LT_OQ) | _mm512_cmp_ps_mask(value, upperBound, _CMP_GT_OQ);
+}
+
+// Same steps as the scalar keepSaturation, on sixteen pixels of codes
+inline void keepSaturation(__m512i pixels, __m512i &r, __m512i &g, __m512i &b)
+{
+    const __m512i byteMask = _mm512_set1_epi32(0xff);
+    const __m512 sourceR   = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(pixels, 16), byteMask));
+    const __m512 sourceG   = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(pixels, 8), byteMask));
+    const __m512 sourceB   = _mm512_cvtepi32_ps(_mm512_and_si512(pixels, byteMask));
+    const __m512 targetR   = _mm512_cvtepi32_ps(r);
+    const __m512 targetG   = _mm512_cvtepi32_ps(g);
+    const __m512 targetB   = _mm512_cvtepi32_ps(b);
+
+    const __m512 sourceMax = _mm512_max_ps(_mm512_max_ps(sourceR, sourceG), sourceB);
+    const __m512 sourceMin = _mm512_min_ps(_mm512_min_ps(sourceR, sourceG), sourceB);
+    const __m512 targetMax = _mm512_max_ps(_mm512_max_ps(targetR, targetG), targetB);
+    const __m512 targetMin = _mm512_min_ps(_mm512_min_ps(targetR, targetG), targetB);
+
+    const __m512 full = _mm512_set1_ps(255.0f);
+    const __m512 sourceRange =
+        _mm512_sub_ps(full, _mm512_abs_ps(_mm512_sub_ps(_mm512_add_ps(sourceMax, sourceMin), full)));
+    const __m512 targetRange =
+        _mm512_sub_ps(full, _mm512_abs_ps(_mm512_sub_ps(_mm512_add_ps(targetMax, targetMin), full)));
+    const __m512 scale = _mm512_div_ps(
+        _mm512_mul_ps(_mm512_sub_ps(sourceMax, sourceMin), targetRange),
+        _mm512_max_ps(_mm512_mul_ps(sourceRange, _mm512_sub_ps(targetMax, targetMin)), _mm512_set1_ps(1.0f))
+    );
+    const __m512 lightness = _mm512_mul_ps(_mm512_add_ps(targetMax, targetMin), _mm512_set1_ps(0.5f));
+
+    auto adjust = [&](__m512 channel)
+    {
+        const __m512 value   = _mm512_add_ps(lightness, _mm512_mul_ps(_mm512_sub_ps(channel, lightness), scale));
+        const __m512 clamped = _mm512_min_ps(_mm512_max_ps(value, _mm512_setzero_ps()), full);
+        return _mm512_cvttps_epi32(_mm512_add_ps(clamped, _mm512_set1_ps(0.5f)));
+    };
+    r = adjust(targetR);
+    g = adjust(targetG);
+    b = adjust(targetB);
+}
+
+// Same steps as the scalar unpremultiplied, on sixteen pixels; alpha stays in the top byte
+inline __m512i unpremultiply(__m512i pixels)
+{
+    const __m512i byteMask = _mm512_set1_epi32(0xff);
+    const __m512 alpha     = _mm512_cvtepi32_ps(_mm512_srli_epi32(pixels, 24));
+    // Transparent pixels skip the division and get a scale of 0
+    const __m512 scale = _mm512_maskz_div_ps(
+        _mm512_cmp_ps_mask(alpha, _mm512_setzero_ps(), _CMP_NEQ_OQ), _mm512_set1_ps(255.0f), alpha
+    );
+    auto straight = [&](__m512i code)
+    {
+        const __m512 scaled = _mm512_add_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(code), scale), _mm512_set1_ps(0.5f));
+        return _mm512_min_epi32(_mm512_cvttps_epi32(scaled), byteMask);
+    };
+    const __m512i r = straight(_mm512_and_si512(_mm512_srli_epi32(pixels, 16), byteMask));
+    const __m512i g = straight(_mm512_and_si512(_mm512_srli_epi32(pixels, 8), byteMask));
+    const __m512i b = straight(_mm512_and_si512(pixels, byteMask));
+    const __m512i straightPixels =
+        _mm512_or_si512(_mm512_slli_epi32(r, 16), _mm512_or_si512(_mm512_slli_epi32(g, 8), b));
+    return _mm512_or_si512(_mm512_and_si512(pixels, _mm512_set1_epi32(static_cast<int>(0xff000000))), straightPixels);
+}
+
+// Same integer steps as the scalar premultiplied
+inline __m512i premultiply(__m512i code, __m512i alpha)
+{
+    const __m512i product = _mm512_mullo_epi32(code, alpha);
+    return _mm512_srli_epi32(
+        _mm512_add_epi32(_mm512_add_epi32(product, _mm512_srli_epi32(product, 8)), _mm512_set1_epi32(0x80)), 8
+    );
+}
+
+template <int Variant>
+void convertRow(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width)
+{
+    constexpr bool KeepSaturation = (Variant & ConversionKernels::KeepSaturationStage) != 0;
+    constexpr bool LinearSource   = (Variant & ConversionKernels::LinearSourceStage) != 0;
+    constexpr bool LinearTarget   = (Variant & ConversionKernels::LinearTargetStage) != 0;
+    constexpr bool WriteMask      = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay        = (Variant & ConversionKernels::OverlayStage) != 0;
+    constexpr bool KeepAlpha      = (Variant & ConversionKernels::AlphaStage) != 0;
+    constexpr bool Premultiplied  = (Variant & ConversionKernels::PremultipliedStage) != 0;
+
+    const float *m = parameters.matrix;
+    const __m512 m0 = _mm512_set1_ps(m[0]), m1 = _mm512_set1_ps(m[1]), m2 = _mm512_set1_ps(m[2]);
+    const __m512 m3 = _mm512_set1_ps(m[3]), m4 = _mm512_set1_ps(m[4]), m5 = _mm512_set1_ps(m[5]);
+    const __m512 m6 = _mm512_set1_ps(m[6]), m7 = _mm512_set1_ps(m[7]), m8 = _mm512_set1_ps(m[8]);
+
+    const __m512 lowerBound    = _mm512_set1_ps(-ColorTransform::OutOfGamutEpsilon);
+    const __m512 upperBound    = _mm512_set1_ps(1.0f + ColorTransform::OutOfGamutEpsilon);
+    const __m512i byteMask     = _mm512_set1_epi32(0xff);
+    const __m512i alphaMask    = _mm512_set1_epi32(static_cast<int>(0xff000000));
+    const __m512i overlayPixel = _mm512_set1_epi32(static_cast<int>(ColorTransform::OverlayPixel));
+    const float *decode        = parameters.decodeLut;
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m512i pixels = _mm512_loadu_si512(source + x);
+        if constexpr (Premultiplied)
+        {
+            pixels = unpremultiply(pixels);
+        }
+        const __m512 r = decodeLanes<LinearSource>(decode, _mm512_and_si512(_mm512_srli_epi32(pixels, 16), byteMask));
+        const __m512 g = decodeLanes<LinearSource>(decode, _mm512_and_si512(_mm512_srli_epi32(pixels, 8), byteMask));
+        const __m512 b = decodeLanes<LinearSource>(decode, _mm512_and_si512(pixels, byteMask));
+
+        // Same evaluation order as the scalar kernel so results match bit for bit
+        const __m512 targetR =
+            _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(m0, r), _mm512_mul_ps(m1, g)), _mm512_mul_ps(m2, b));
+        const __m512 targetG =
+            _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(m3, r), _mm512_mul_ps(m4, g)), _mm512_mul_ps(m5, b));
+        const __m512 targetB =
+            _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(m6, r), _mm512_mul_ps(m7, g)), _mm512_mul_ps(m8, b));
+
+        __mmask16 outOfGamut = 0;
+        if constexpr (WriteMask || Overlay)
+        {
+            outOfGamut = outOfRange(targetR, lowerBound, upperBound) | outOfRange(targetG, lowerBound, upperBound) |
+                         outOfRange(targetB, lowerBound, upperBound);
+        }
+        if constexpr (WriteMask)
+        {
+            mask[x >> 3]       = static_cast<uchar>(outOfGamut);
+            mask[(x >> 3) + 1] = static_cast<uchar>(outOfGamut >> 8);
+        }
+
+        __m512i codeR = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetR);
+        __m512i codeG = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetG);
+        __m512i codeB = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetB);
+        if constexpr (KeepSaturation)
+        {
+            keepSaturation(pixels, codeR, codeG, codeB);
+        }
+        if constexpr (Premultiplied)
+        {
+            const __m512i alphaCodes = _mm512_srli_epi32(pixels, 24);
+            codeR                    = premultiply(codeR, alphaCodes);
+            codeG                    = premultiply(codeG, alphaCodes);
+            codeB                    = premultiply(codeB, alphaCodes);
+        }
+
+        const __m512i alpha = KeepAlpha || Premultiplied ? _mm512_and_si512(pixels, alphaMask) : alphaMask;
+        __m512i encoded     = _mm512_or_si512(alpha, _mm512_slli_epi32(codeR, 16));
+        encoded         = _mm512_or_si512(encoded, _mm512_slli_epi32(codeG, 8));
+        encoded         = _mm512_or_si512(encoded, codeB);
+        if constexpr (Overlay)
+        {
+            encoded = _mm512_mask_blend_epi32(outOfGamut, encoded, overlayPixel);
+        }
+        _mm512_storeu_si512(target + x, encoded);
+    }
+
+    ConversionKernels::convertRowScalar(
+        parameters, source + x, target + x, WriteMask ? mask + (x >> 3) : nullptr, width - x
+    );
+}
+
+template <int... Variants>
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel>
+makeKernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertRow<Variants>...}};
+}
+
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel> avx512Kernels =
+    makeKernelTable(std::make_integer_sequence<int, ConversionKernels::VariantCount>());
+} // namespace
+
+void ConversionKernels::convertRowAVX512(
+    const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width
+)
+{
+    avx512Kernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+#endif // IMAGEPROFILECONVERTER_X86_KERNELS
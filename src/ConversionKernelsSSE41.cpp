@@ -0,0 +1,231 @@
+#include "ColorTransform.h"
+#include "ConversionKernels.h"
+#include "TransferFunction.h"
+
+#ifdef IMAGEPROFILECONVERTER_X86_KERNELS
+#include <immintrin.h>
+#include <utility>
+
+namespace
+{
+// SSE4.1 has no gather, so table reads go through the lanes one by one
+template <bool Linear>
+inline __m128 decodeLanes(const float *lut, __m128i indices)
+{
+    if constexpr (Linear)
+    {
+        return _mm_mul_ps(_mm_cvtepi32_ps(indices), _mm_set1_ps(1.0f / 255.0f));
+    }
+    return _mm_setr_ps(
+        lut[_mm_extract_epi32(indices, 0)], lut[_mm_extract_epi32(indices, 1)], lut[_mm_extract_epi32(indices, 2)],
+        lut[_mm_extract_epi32(indices, 3)]
+    );
+}
+
+template <bool Linear>
+inline __m128i encodeLanes(const uchar *lut, int roots, __m128 linear)
+{
+    // max returns its second operand for NaN, so NaN clamps to 0 like in the scalar kernel
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(linear, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    if constexpr (Linear)
+    {
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+    }
+    __m128 root = clamped;
+    for (int i = 0; i < roots; ++i)
+    {
+        root = _mm_sqrt_ps(root);
+    }
+    const __m128 scaled  = _mm_add_ps(
+        _mm_mul_ps(root, _mm_set1_ps(float(TransferFunction::EncodeSize - 1))), _mm_set1_ps(0.5f)
+    );
+    const __m128i indices = _mm_cvttps_epi32(scaled);
+    return _mm_setr_epi32(
+        lut[_mm_extract_epi32(indices, 0)], lut[_mm_extract_epi32(indices, 1)], lut[_mm_extract_epi32(indices, 2)],
+        lut[_mm_extract_epi32(indices, 3)]
+    );
+}
+
+inline __m128 absolute(__m128 value)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+}
+
+// Same steps as the scalar keepSaturation, on four pixels of codes
+inline void keepSaturation(__m128i pixels, __m128i &r, __m128i &g, __m128i &b)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128 sourceR   = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask));
+    const __m128 sourceG   = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), byteMask));
+    const __m128 sourceB   = _mm_cvtepi32_ps(_mm_and_si128(pixels, byteMask));
+    const __m128 targetR   = _mm_cvtepi32_ps(r);
+    const __m128 targetG   = _mm_cvtepi32_ps(g);
+    const __m128 targetB   = _mm_cvtepi32_ps(b);
+
+    const __m128 sourceMax = _mm_max_ps(_mm_max_ps(sourceR, sourceG), sourceB);
+    const __m128 sourceMin = _mm_min_ps(_mm_min_ps(sourceR, sourceG), sourceB);
+    const __m128 targetMax = _mm_max_ps(_mm_max_ps(targetR, targetG), targetB);
+    const __m128 targetMin = _mm_min_ps(_mm_min_ps(targetR, targetG), targetB);
+
+    const __m128 full        = _mm_set1_ps(255.0f);
+    const __m128 sourceRange = _mm_sub_ps(full, absolute(_mm_sub_ps(_mm_add_ps(sourceMax, sourceMin), full)));
+    const __m128 targetRange = _mm_sub_ps(full, absolute(_mm_sub_ps(_mm_add_ps(targetMax, targetMin), full)));
+    const __m128 scale       = _mm_div_ps(
+        _mm_mul_ps(_mm_sub_ps(sourceMax, sourceMin), targetRange),
+        _mm_max_ps(_mm_mul_ps(sourceRange, _mm_sub_ps(targetMax, targetMin)), _mm_set1_ps(1.0f))
+    );
+    const __m128 lightness = _mm_mul_ps(_mm_add_ps(targetMax, targetMin), _mm_set1_ps(0.5f));
+
+    auto adjust = [&](__m128 channel)
+    {
+        const __m128 value   = _mm_add_ps(lightness, _mm_mul_ps(_mm_sub_ps(channel, lightness), scale));
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), full);
+        return _mm_cvttps_epi32(_mm_add_ps(clamped, _mm_set1_ps(0.5f)));
+    };
+    r = adjust(targetR);
+    g = adjust(targetG);
+    b = adjust(targetB);
+}
+
+// Same steps as the scalar unpremultiplied, on four pixels; alpha stays in the top byte
+inline __m128i unpremultiply(__m128i pixels)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128 alpha     = _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24));
+    // 255 / 0 is infinity, the comparison turns the scale to 0 for transparent pixels
+    const __m128 scale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(255.0f), alpha), _mm_cmpneq_ps(alpha, _mm_setzero_ps()));
+    auto straight      = [&](__m128i code)
+    {
+        const __m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(code), scale), _mm_set1_ps(0.5f));
+        return _mm_min_epi32(_mm_cvttps_epi32(scaled), byteMask);
+    };
+    const __m128i r              = straight(_mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask));
+    const __m128i g              = straight(_mm_and_si128(_mm_srli_epi32(pixels, 8), byteMask));
+    const __m128i b              = straight(_mm_and_si128(pixels, byteMask));
+    const __m128i straightPixels = _mm_or_si128(_mm_slli_epi32(r, 16), _mm_or_si128(_mm_slli_epi32(g, 8), b));
+    return _mm_or_si128(_mm_and_si128(pixels, _mm_set1_epi32(static_cast<int>(0xff000000))), straightPixels);
+}
+
+// Same integer steps as the scalar premultiplied
+inline __m128i premultiply(__m128i code, __m128i alpha)
+{
+    const __m128i product = _mm_mullo_epi32(code, alpha);
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(product, _mm_srli_epi32(product, 8)), _mm_set1_epi32(0x80)), 8);
+}
+
+template <int Variant>
+void convertRow(const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width)
+{
+    constexpr bool KeepSaturation = (Variant & ConversionKernels::KeepSaturationStage) != 0;
+    constexpr bool LinearSource   = (Variant & ConversionKernels::LinearSourceStage) != 0;
+    constexpr bool LinearTarget   = (Variant & ConversionKernels::LinearTargetStage) != 0;
+    constexpr bool WriteMask      = (Variant & ConversionKernels::MaskStage) != 0;
+    constexpr bool Overlay        = (Variant & ConversionKernels::OverlayStage) != 0;
+    constexpr bool KeepAlpha      = (Variant & ConversionKernels::AlphaStage) != 0;
+    constexpr bool Premultiplied  = (Variant & ConversionKernels::PremultipliedStage) != 0;
+
+    const float *m = parameters.matrix;
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+    const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+
+    const __m128 lowerBound    = _mm_set1_ps(-ColorTransform::OutOfGamutEpsilon);
+    const __m128 upperBound    = _mm_set1_ps(1.0f + ColorTransform::OutOfGamutEpsilon);
+    const __m128i byteMask     = _mm_set1_epi32(0xff);
+    const __m128i alphaMask    = _mm_set1_epi32(static_cast<int>(0xff000000));
+    const __m128i overlayPixel = _mm_set1_epi32(static_cast<int>(ColorTransform::OverlayPixel));
+
+    // Converts four pixels and returns their mask bits
+    auto convertLanes = [&](int x)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x));
+        if constexpr (Premultiplied)
+        {
+            pixels = unpremultiply(pixels);
+        }
+        const __m128 r =
+            decodeLanes<LinearSource>(parameters.decodeLut, _mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask));
+        const __m128 g =
+            decodeLanes<LinearSource>(parameters.decodeLut, _mm_and_si128(_mm_srli_epi32(pixels, 8), byteMask));
+        const __m128 b = decodeLanes<LinearSource>(parameters.decodeLut, _mm_and_si128(pixels, byteMask));
+
+        // Same evaluation order as the scalar kernel so results match bit for bit
+        const __m128 targetR = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, r), _mm_mul_ps(m1, g)), _mm_mul_ps(m2, b));
+        const __m128 targetG = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, r), _mm_mul_ps(m4, g)), _mm_mul_ps(m5, b));
+        const __m128 targetB = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, r), _mm_mul_ps(m7, g)), _mm_mul_ps(m8, b));
+
+        __m128 outOfGamut = _mm_setzero_ps();
+        if constexpr (WriteMask || Overlay)
+        {
+            outOfGamut = _mm_or_ps(_mm_cmplt_ps(targetR, lowerBound), _mm_cmpgt_ps(targetR, upperBound));
+            outOfGamut = _mm_or_ps(
+                outOfGamut, _mm_or_ps(_mm_cmplt_ps(targetG, lowerBound), _mm_cmpgt_ps(targetG, upperBound))
+            );
+            outOfGamut = _mm_or_ps(
+                outOfGamut, _mm_or_ps(_mm_cmplt_ps(targetB, lowerBound), _mm_cmpgt_ps(targetB, upperBound))
+            );
+        }
+
+        __m128i codeR = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetR);
+        __m128i codeG = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetG);
+        __m128i codeB = encodeLanes<LinearTarget>(parameters.encodeLut, parameters.encodeRoots, targetB);
+        if constexpr (KeepSaturation)
+        {
+            keepSaturation(pixels, codeR, codeG, codeB);
+        }
+        if constexpr (Premultiplied)
+        {
+            const __m128i alphaCodes = _mm_srli_epi32(pixels, 24);
+            codeR                    = premultiply(codeR, alphaCodes);
+            codeG                    = premultiply(codeG, alphaCodes);
+            codeB                    = premultiply(codeB, alphaCodes);
+        }
+
+        const __m128i alpha = KeepAlpha || Premultiplied ? _mm_and_si128(pixels, alphaMask) : alphaMask;
+        __m128i encoded     = _mm_or_si128(alpha, _mm_slli_epi32(codeR, 16));
+        encoded         = _mm_or_si128(encoded, _mm_slli_epi32(codeG, 8));
+        encoded         = _mm_or_si128(encoded, codeB);
+        if constexpr (Overlay)
+        {
+            encoded = _mm_blendv_epi8(encoded, overlayPixel, _mm_castps_si128(outOfGamut));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), encoded);
+
+        return _mm_movemask_ps(outOfGamut);
+    };
+
+    // Eight pixels per step, so every mask byte is written whole
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const int bits = convertLanes(x) | convertLanes(x + 4) << 4;
+        if constexpr (WriteMask)
+        {
+            mask[x >> 3] = static_cast<uchar>(bits);
+        }
+    }
+
+    ConversionKernels::convertRowScalar(
+        parameters, source + x, target + x, WriteMask ? mask + (x >> 3) : nullptr, width - x
+    );
+}
+
+template <int... Variants>
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel>
+makeKernelTable(std::integer_sequence<int, Variants...>)
+{
+    return {{&convertRow<Variants>...}};
+}
+
+constexpr ConversionKernels::KernelTable<ConversionKernels::RowKernel> sse41Kernels =
+    makeKernelTable(std::make_integer_sequence<int, ConversionKernels::VariantCount>());
+} // namespace
+
+void ConversionKernels::convertRowSSE41(
+    const KernelParameters &parameters, const QRgb *source, QRgb *target, uchar *mask, int width
+)
+{
+    sse41Kernels.kernels[variant(parameters, mask != nullptr)](parameters, source, target, mask, width);
+}
+
+#endif // IMAGEPROFILECONVERTER_X86_KERNELS
@@ -0,0 +1,238 @@
+#include "ConversionProfiler.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <set>
+
+namespace
+{
+// Small, stable numbers for the trace viewer instead of native thread handles
+int currentThread()
+{
+    static std::atomic_int nextThread(1);
+    thread_local const int thread = nextThread++;
+    return thread;
+}
+
+double milliseconds(qint64 nanoseconds)
+{
+    return nanoseconds / 1e6;
+}
+
+double microseconds(qint64 nanoseconds)
+{
+    return nanoseconds / 1e3;
+}
+
+void setError(QString *errorString, const QString &message)
+{
+    if (errorString != nullptr)
+    {
+        *errorString = message;
+    }
+}
+} // namespace
+
+ConversionProfiler::ConversionProfiler() : origin(std::chrono::steady_clock::now())
+{
+}
+
+qint64 ConversionProfiler::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void ConversionProfiler::addEvent(const char *name, const char *category, qint64 startNs, qint64 durationNs)
+{
+    const int thread = currentThread();
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back({name, category, thread, startNs, durationNs});
+}
+
+void ConversionProfiler::add(const char *counter, qint64 value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    counters[QString::fromLatin1(counter)] += value;
+}
+
+qint64 ConversionProfiler::counter(const char *counter) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto found = counters.find(QString::fromLatin1(counter));
+    return found != counters.end() ? found->second : 0;
+}
+
+std::vector<ConversionProfiler::StageSummary> ConversionProfiler::stages() const
+{
+    std::vector<StageSummary> summaries;
+    std::vector<std::set<int>> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Event &event : events)
+        {
+            if (std::strcmp(event.category, StageCategory) != 0)
+            {
+                continue;
+            }
+            const QString name = QString::fromLatin1(event.name);
+            auto summary       = std::find_if(
+                summaries.begin(), summaries.end(), [&](const StageSummary &stage) { return stage.name == name; }
+            );
+            if (summary == summaries.end())
+            {
+                summaries.push_back({name, 0, 0, event.startNs, event.startNs, 0});
+                threads.emplace_back();
+                summary = summaries.end() - 1;
+            }
+            ++summary->count;
+            summary->totalNs += event.durationNs;
+            summary->firstNs = std::min(summary->firstNs, event.startNs);
+            summary->lastNs  = std::max(summary->lastNs, event.startNs + event.durationNs);
+            threads[summary - summaries.begin()].insert(event.thread);
+        }
+    }
+    for (size_t i = 0; i < summaries.size(); ++i)
+    {
+        summaries[i].threads = static_cast<int>(threads[i].size());
+    }
+
+    std::stable_sort(
+        summaries.begin(), summaries.end(),
+        [](const StageSummary &a, const StageSummary &b) { return a.firstNs < b.firstNs; }
+    );
+    return summaries;
+}
+
+double ConversionProfiler::threadUtilization() const
+{
+    const qint64 capacity = counter(CapacityCounter);
+    return capacity > 0 ? std::min(1.0, static_cast<double>(counter(BusyCounter)) / capacity) : 0.0;
+}
+
+QString ConversionProfiler::summaryText() const
+{
+    QStringList parts;
+    for (const StageSummary &stage : stages())
+    {
+        parts << QString("%1 %2 ms").arg(stage.name).arg(milliseconds(stage.totalNs), 0, 'f', 1);
+    }
+
+    const qint64 pixels = counter(PixelsCounter);
+    if (pixels > 0)
+    {
+        parts << QString("%1 MP").arg(pixels / 1e6, 0, 'f', 1);
+        const qint64 outOfGamut = counter(OutOfGamutCounter);
+        if (outOfGamut > 0)
+        {
+            parts << QString("%1% out of gamut").arg(100.0 * outOfGamut / pixels, 0, 'f', 1);
+        }
+    }
+    const qint64 allocated = counter(AllocatedCounter);
+    if (allocated > 0)
+    {
+        parts << QString("%1 MB allocated").arg(allocated / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+    if (counter(CapacityCounter) > 0)
+    {
+        parts << QString("%1% thread utilization").arg(100.0 * threadUtilization(), 0, 'f', 0);
+    }
+    return parts.join(", ");
+}
+
+QJsonObject ConversionProfiler::toJson() const
+{
+    const std::vector<StageSummary> summaries = stages();
+    QJsonArray stageArray;
+    // Stages come sorted by their start
+    const qint64 firstNs = summaries.empty() ? 0 : summaries.front().firstNs;
+    qint64 lastNs        = firstNs;
+    for (const StageSummary &stage : summaries)
+    {
+        QJsonObject entry;
+        entry["name"]    = stage.name;
+        entry["count"]   = stage.count;
+        entry["totalMs"] = milliseconds(stage.totalNs);
+        entry["wallMs"]  = milliseconds(stage.lastNs - stage.firstNs);
+        entry["threads"] = stage.threads;
+        stageArray.append(entry);
+        lastNs = std::max(lastNs, stage.lastNs);
+    }
+
+    QJsonObject counterObject;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &entry : counters)
+        {
+            counterObject[entry.first] = entry.second;
+        }
+    }
+
+    QJsonObject json;
+    json["wallMs"]            = milliseconds(lastNs - firstNs);
+    json["stages"]            = stageArray;
+    json["counters"]          = counterObject;
+    json["threadUtilization"] = threadUtilization();
+    return json;
+}
+
+QJsonObject ConversionProfiler::toChromeTrace() const
+{
+    QJsonArray traceEvents;
+    QJsonObject counterArguments;
+    qint64 endNs = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Event &event : events)
+        {
+            QJsonObject entry;
+            entry["name"] = QString::fromLatin1(event.name);
+            entry["cat"]  = QString::fromLatin1(event.category);
+            entry["ph"]   = "X";
+            entry["ts"]   = microseconds(event.startNs);
+            entry["dur"]  = microseconds(event.durationNs);
+            entry["pid"]  = 1;
+            entry["tid"]  = event.thread;
+            traceEvents.append(entry);
+            endNs = std::max(endNs, event.startNs + event.durationNs);
+        }
+        for (const auto &entry : counters)
+        {
+            counterArguments[entry.first] = entry.second;
+        }
+    }
+
+    QJsonObject counterEvent;
+    counterEvent["name"] = "counters";
+    counterEvent["ph"]   = "C";
+    counterEvent["ts"]   = microseconds(endNs);
+    counterEvent["pid"]  = 1;
+    counterEvent["args"] = counterArguments;
+    traceEvents.append(counterEvent);
+
+    QJsonObject trace;
+    trace["traceEvents"]     = traceEvents;
+    trace["displayTimeUnit"] = "ms";
+    return trace;
+}
+
+bool ConversionProfiler::save(const QString &path, ExportFormat format, QString *errorString) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        setError(errorString, file.errorString());
+        return false;
+    }
+
+    const QByteArray bytes = QJsonDocument(format == ExportFormat::ChromeTrace ? toChromeTrace() : toJson()).toJson();
+    if (file.write(bytes) != bytes.size() || !file.commit())
+    {
+        setError(errorString, file.errorString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,151 @@
+#include "ImageBufferPool.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <utility>
+
+namespace
+{
+constexpr std::align_val_t BufferAlignment{64};
+
+struct BufferKey
+{
+    int width;
+    int height;
+    QImage::Format format;
+
+    bool operator<(const BufferKey &other) const
+    {
+        return std::tie(width, height, format) < std::tie(other.width, other.height, other.format);
+    }
+};
+
+// Rows padded to whole cache lines, which QImage accepts as long as they stay 4-byte aligned
+qsizetype bytesPerLine(int width, QImage::Format format)
+{
+    const qsizetype rowBytes = (static_cast<qsizetype>(width) * QImage::toPixelFormat(format).bitsPerPixel() + 7) / 8;
+    return (rowBytes + 63) & ~qsizetype(63);
+}
+
+void freeBuffer(uchar *bits)
+{
+    ::operator delete(bits, BufferAlignment);
+}
+} // namespace
+
+struct ImageBufferPool::State
+{
+    std::mutex mutex;
+    std::multimap<BufferKey, std::pair<uchar *, qsizetype>> idle;
+    qint64 maxIdleBytes = 0;
+    bool closed         = false; // The pool is gone, buffers coming back are freed
+    Statistics counters;
+};
+
+// Cleanup info of one handed out image
+struct ImageBufferPool::Lease
+{
+    std::shared_ptr<State> state;
+    BufferKey key;
+    uchar *bits;
+    qsizetype bytes;
+};
+
+ImageBufferPool::ImageBufferPool(qint64 maxIdleBytes) : state(std::make_shared<State>())
+{
+    state->maxIdleBytes = maxIdleBytes;
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->closed = true;
+    }
+    trim();
+}
+
+QImage ImageBufferPool::image(const QSize &size, QImage::Format format)
+{
+    if (size.isEmpty() || format == QImage::Format_Invalid)
+    {
+        return QImage();
+    }
+
+    const BufferKey key{size.width(), size.height(), format};
+    const qsizetype rowBytes = bytesPerLine(size.width(), format);
+    const qsizetype bytes    = rowBytes * size.height();
+
+    uchar *bits = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        const auto found = state->idle.find(key);
+        if (found != state->idle.end())
+        {
+            bits = found->second.first;
+            state->idle.erase(found);
+            state->counters.idleBytes -= bytes;
+            state->counters.reusedBytes += bytes;
+        }
+        else
+        {
+            state->counters.allocatedBytes += bytes;
+        }
+        state->counters.inUseBytes += bytes;
+        state->counters.peakBytes =
+            std::max(state->counters.peakBytes, state->counters.inUseBytes + state->counters.idleBytes);
+    }
+    if (bits == nullptr)
+    {
+        bits = static_cast<uchar *>(::operator new(bytes, BufferAlignment));
+    }
+
+    return QImage(
+        bits, size.width(), size.height(), rowBytes, format, &ImageBufferPool::release,
+        new Lease{state, key, bits, bytes}
+    );
+}
+
+QImage ImageBufferPool::image(ImageBufferPool *pool, const QSize &size, QImage::Format format)
+{
+    return pool != nullptr ? pool->image(size, format) : QImage(size, format);
+}
+
+void ImageBufferPool::release(void *info)
+{
+    std::unique_ptr<Lease> lease(static_cast<Lease *>(info));
+    State &state = *lease->state;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.counters.inUseBytes -= lease->bytes;
+        if (!state.closed && state.counters.idleBytes + lease->bytes <= state.maxIdleBytes)
+        {
+            state.idle.emplace(lease->key, std::make_pair(lease->bits, lease->bytes));
+            state.counters.idleBytes += lease->bytes;
+            return;
+        }
+    }
+    freeBuffer(lease->bits);
+}
+
+ImageBufferPool::Statistics ImageBufferPool::statistics() const
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->counters;
+}
+
+void ImageBufferPool::trim()
+{
+    std::multimap<BufferKey, std::pair<uchar *, qsizetype>> idle;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        idle.swap(state->idle);
+        state->counters.idleBytes = 0;
+    }
+    for (const auto &entry : idle)
+    {
+        freeBuffer(entry.second.first);
+    }
+}
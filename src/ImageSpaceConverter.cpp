@@ -4,32 +4,55 @@
 
 #include "ImageSpaceConverter.h"
 #include "ColorProfileSettings.h"
+#include "ColorTransform.h"
+#include "ConversionProfiler.h"
+#include "ThreadPool.h"
+#include "TransformCache.h"
 #include <QColor>
 #include <QImage>
 #include <QMatrix4x4>
 #include <QVector2D>
 #include <QVector4D>
 #include <complex>
-#include <functional>
 #include <qvector3d.h>
-#include <unordered_map>
-
-std::unordered_map<
-    ConversionType,
-    std::function<ConversionOutput(const QImage &, const ColorProfileSettings &, const ColorProfileSettings &)>>
-    ImageSpaceConverter::conversionMethods = {
-        {ConversionType::AbsoluteColorimetric, &ImageSpaceConverter::convertAbsoluteColorimetric},
-        {ConversionType::RelativeColorimetric, &ImageSpaceConverter::convertRelativeColorimetric},
-        {          ConversionType::Perceptual,           &ImageSpaceConverter::convertPerceptual},
-        {          ConversionType::Saturation,   &ImageSpaceConverter::convertPreserveSaturation}
-};
+
+namespace
+{
+// Timed on its own: a plan the cache does not hold yet costs a matrix build and possibly a disk read
+ColorTransform plan(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, ConversionProfiler *profiler
+)
+{
+    ConversionProfiler::Scope scope(profiler, "plan");
+    return TransformCache::global().transform(sourceProfile, targetProfile, conversionType);
+}
+} // namespace
+
+ConversionOutput ImageSpaceConverter::convert(
+    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, const ConversionOptions &options
+)
+{
+    // The intent is part of the plan: its matrix, and the kernel instantiation the plan picks for every row
+    return plan(sourceProfile, targetProfile, conversionType, options.profiler).convert(sourceImage, options);
+}
 
 ConversionOutput ImageSpaceConverter::convert(
     const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
-    ConversionType conversionType
+    ConversionType conversionType, const QRect &region, double scale, const ConversionOptions &options
 )
 {
-    return ImageSpaceConverter::conversionMethods[conversionType](sourceImage, sourceProfile, targetProfile);
+    return plan(sourceProfile, targetProfile, conversionType, options.profiler)
+        .convert(sourceImage, region, scale, options);
+}
+
+QImage ImageSpaceConverter::convertInPlace(
+    QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, const ConversionOptions &options
+)
+{
+    return plan(sourceProfile, targetProfile, conversionType, options.profiler).convertInPlace(sourceImage, options);
 }
 
 // Helper: Compute RGB to XYZ transformation matrix
@@ -85,6 +108,11 @@ QVector3D ImageSpaceConverter::transformColor(
 
 QVector3D
 ImageSpaceConverter::adjustWhitePoint(const QVector3D &color, const double2 &sourceWhite, const double2 &targetWhite)
+{
+    return computeChromaticAdaptationMatrix(sourceWhite, targetWhite).mapVector(color);
+}
+
+QMatrix4x4 ImageSpaceConverter::computeChromaticAdaptationMatrix(const double2 &sourceWhite, const double2 &targetWhite)
 {
     // Bradford transformation matrix
     QMatrix4x4 bradford;
@@ -108,153 +136,44 @@ ImageSpaceConverter::adjustWhitePoint(const QVector3D &color, const double2 &sou
     QMatrix4x4 adaptationMatrix;
     adaptationMatrix.scale(adaptationScale);
 
-    QVector3D adaptedColor = inverseBradford.mapVector(adaptationMatrix.mapVector(bradford.mapVector(color)));
-
-    return adaptedColor;
+    return inverseBradford * adaptationMatrix * bradford;
 }
 
 ConversionOutput ImageSpaceConverter::convertAbsoluteColorimetric(
-    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    const ConversionOptions &options
 )
 {
-    QImage resultImage = sourceImage.convertToFormat(QImage::Format_RGB32);
-    QImage outOfGamutMask(resultImage.size(), QImage::Format_RGB32);
-
-    QMatrix4x4 sourceRGBtoXYZ =
-        computeRGBtoXYZMatrix(sourceProfile.white, sourceProfile.red, sourceProfile.green, sourceProfile.blue);
-    QMatrix4x4 targetRGBtoXYZ =
-        computeRGBtoXYZMatrix(targetProfile.white, targetProfile.red, targetProfile.green, targetProfile.blue);
-    QMatrix4x4 targetXYZtoRGB = targetRGBtoXYZ.inverted();
-
-    for (int y = 0; y < resultImage.height(); ++y)
-    {
-        for (int x = 0; x < resultImage.width(); ++x)
-        {
-            QColor color        = resultImage.pixelColor(x, y);
-            QVector3D linearRGB = applyGammaCorrection(color, sourceProfile.gamma);
-            QVector3D targetRGB = transformColor(linearRGB, sourceRGBtoXYZ, targetXYZtoRGB);
-            if (outOfGamut(targetRGB))
-            {
-                outOfGamutMask.setPixelColor(x, y, Qt::white);
-            }
-            else
-            {
-                outOfGamutMask.setPixelColor(x, y, Qt::black);
-            }
-            resultImage.setPixelColor(x, y, applyInverseGammaCorrection(targetRGB, targetProfile.gamma));
-        }
-    }
-
-    return {resultImage, outOfGamutMask};
+    return plan(sourceProfile, targetProfile, ConversionType::AbsoluteColorimetric, options.profiler)
+        .convert(sourceImage, options);
 }
 
 ConversionOutput ImageSpaceConverter::convertRelativeColorimetric(
-    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    const ConversionOptions &options
 )
 {
-    QImage resultImage = sourceImage.convertToFormat(QImage::Format_RGB32);
-    QImage outOfGamutMask(resultImage.size(), QImage::Format_RGB32);
-
-    QMatrix4x4 sourceRGBtoXYZ =
-        computeRGBtoXYZMatrix(sourceProfile.white, sourceProfile.red, sourceProfile.green, sourceProfile.blue);
-    QMatrix4x4 targetRGBtoXYZ =
-        computeRGBtoXYZMatrix(targetProfile.white, targetProfile.red, targetProfile.green, targetProfile.blue);
-    QMatrix4x4 targetXYZtoRGB = targetRGBtoXYZ.inverted();
-
-    for (int y = 0; y < resultImage.height(); ++y)
-    {
-        for (int x = 0; x < resultImage.width(); ++x)
-        {
-            QColor color          = resultImage.pixelColor(x, y);
-            QVector3D linearRGB   = applyGammaCorrection(color, sourceProfile.gamma);
-            QVector3D adjustedRGB = adjustWhitePoint(linearRGB, sourceProfile.white, targetProfile.white);
-            QVector3D targetRGB   = transformColor(adjustedRGB, sourceRGBtoXYZ, targetXYZtoRGB);
-            if (outOfGamut(targetRGB))
-            {
-                outOfGamutMask.setPixelColor(x, y, Qt::white);
-            }
-            else
-            {
-                outOfGamutMask.setPixelColor(x, y, Qt::black);
-            }
-            resultImage.setPixelColor(x, y, applyInverseGammaCorrection(targetRGB, targetProfile.gamma));
-        }
-    }
-
-    return {resultImage, outOfGamutMask};
+    return plan(sourceProfile, targetProfile, ConversionType::RelativeColorimetric, options.profiler)
+        .convert(sourceImage, options);
 }
 
 ConversionOutput ImageSpaceConverter::convertPerceptual(
-    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    const ConversionOptions &options
 )
 {
-    QImage resultImage = sourceImage.convertToFormat(QImage::Format_RGB32);
-    QImage outOfGamutMask(resultImage.size(), QImage::Format_RGB32);
-
-    QMatrix4x4 sourceRGBtoXYZ =
-        computeRGBtoXYZMatrix(sourceProfile.white, sourceProfile.red, sourceProfile.green, sourceProfile.blue);
-    QMatrix4x4 targetRGBtoXYZ =
-        computeRGBtoXYZMatrix(targetProfile.white, targetProfile.red, targetProfile.green, targetProfile.blue);
-    QMatrix4x4 targetXYZtoRGB = targetRGBtoXYZ.inverted();
-
-    for (int y = 0; y < resultImage.height(); ++y)
-    {
-        for (int x = 0; x < resultImage.width(); ++x)
-        {
-            QColor color        = resultImage.pixelColor(x, y);
-            QVector3D linearRGB = applyGammaCorrection(color, sourceProfile.gamma);
-            QVector3D xyz       = sourceRGBtoXYZ.mapVector(linearRGB);
-            QVector3D scaledXYZ = scaleToTargetGamut(xyz, sourceProfile, targetProfile);
-            QVector3D targetRGB = targetXYZtoRGB.mapVector(scaledXYZ);
-            if (outOfGamut(targetRGB))
-            {
-                outOfGamutMask.setPixelColor(x, y, Qt::white);
-            }
-            else
-            {
-                outOfGamutMask.setPixelColor(x, y, Qt::black);
-            }
-            QColor finalColor = applyInverseGammaCorrection(targetRGB, targetProfile.gamma);
-            resultImage.setPixelColor(x, y, finalColor);
-        }
-    }
-
-    // No out of gamut mask for perceptual conversion
-    return {resultImage, outOfGamutMask};
+    return plan(sourceProfile, targetProfile, ConversionType::Perceptual, options.profiler)
+        .convert(sourceImage, options);
 }
 
 // Conversion: Saturation
 ConversionOutput ImageSpaceConverter::convertPreserveSaturation(
-    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    const ConversionOptions &options
 )
 {
-    ConversionOutput output = convertAbsoluteColorimetric(sourceImage, sourceProfile, targetProfile);
-    QImage &resultImage     = output.convertedImage;
-
-    for (int y = 0; y < resultImage.height(); ++y)
-    {
-        for (int x = 0; x < resultImage.width(); ++x)
-        {
-            QColor targetColor = resultImage.pixelColor(x, y);
-            QColor sourceColor = sourceImage.pixelColor(x, y);
-
-            float sourceH, sourceS, sourceL;
-            rgbToHsl(
-                QVector3D(sourceColor.redF(), sourceColor.greenF(), sourceColor.blueF()), sourceH, sourceS, sourceL
-            );
-            float targetH, targetS, targetL;
-            rgbToHsl(
-                QVector3D(targetColor.redF(), targetColor.greenF(), targetColor.blueF()), targetH, targetS, targetL
-            );
-
-            // Keep source saturation
-            QVector3D adjustedRgb = hslToRgb(targetH, sourceS, targetL);
-
-            resultImage.setPixelColor(x, y, QColor::fromRgbF(adjustedRgb.x(), adjustedRgb.y(), adjustedRgb.z()));
-        }
-    }
-
-    return output;
+    return plan(sourceProfile, targetProfile, ConversionType::Saturation, options.profiler)
+        .convert(sourceImage, options);
 }
 
 void ImageSpaceConverter::rgbToHsl(const QVector3D &rgb, float &h, float &s, float &l)
@@ -329,14 +248,20 @@ QVector3D ImageSpaceConverter::hslToRgb(float h, float s, float l)
 QVector3D ImageSpaceConverter::scaleToTargetGamut(
     const QVector3D &xyz, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
 )
+{
+    return computeGamutScalingMatrix(sourceProfile, targetProfile).mapVector(xyz);
+}
+
+QMatrix4x4 ImageSpaceConverter::computeGamutScalingMatrix(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile
+)
 {
     QVector3D sourceMax = computeXYZGamutBounds(sourceProfile);
     QVector3D targetMax = computeXYZGamutBounds(targetProfile);
 
-    QVector3D scaleFactors =
-        QVector3D(targetMax.x() / sourceMax.x(), targetMax.y() / sourceMax.y(), targetMax.z() / sourceMax.z());
-
-    return QVector3D(xyz.x() * scaleFactors.x(), xyz.y() * scaleFactors.y(), xyz.z() * scaleFactors.z());
+    QMatrix4x4 scaleMatrix;
+    scaleMatrix.scale(targetMax.x() / sourceMax.x(), targetMax.y() / sourceMax.y(), targetMax.z() / sourceMax.z());
+    return scaleMatrix;
 }
 
 QVector3D ImageSpaceConverter::computeXYZGamutBounds(const ColorProfileSettings &profile)
@@ -359,16 +284,77 @@ bool ImageSpaceConverter::outOfGamut(const QVector3D &rgb)
            rgb.y() > 1.0 + epsilon || rgb.z() > 1.0 + epsilon;
 }
 
-void ImageSpaceConverter::maskImage(QImage &image, QImage &mask)
+void ImageSpaceConverter::maskImage(QImage &image, const QImage &mask, int threadCount, ConversionProfiler *profiler)
 {
-    for (int y = 0; y < image.height(); ++y)
+    ConversionProfiler::Scope scope(profiler, "maskImage");
+    if (mask.size() != image.size())
+    {
+        return;
+    }
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32 &&
+        image.format() != QImage::Format_ARGB32_Premultiplied)
     {
-        for (int x = 0; x < image.width(); ++x)
+        image = image.convertToFormat(QImage::Format_RGB32);
+    }
+
+    // White mask pixels are out of gamut, whatever the format. Bitmaps are read through their color table, so no
+    // copy is made for masks coming out of ColorTransform; other formats are compared as ARGB32.
+    const bool bitmap = mask.format() == QImage::Format_Mono || mask.format() == QImage::Format_MonoLSB;
+    const QImage maskPixels = mask.convertToFormat(bitmap ? QImage::Format_MonoLSB : QImage::Format_ARGB32);
+    bool paintsBit[2] = {false, false};
+    if (bitmap)
+    {
+        for (int bit = 0; bit < 2; ++bit)
         {
-            if (mask.pixelColor(x, y) == QColor(Qt::white))
-            {
-                image.setPixelColor(x, y, QColor(Qt::magenta));
-            }
+            paintsBit[bit] = maskPixels.colorCount() > bit && maskPixels.color(bit) == ColorTransform::WhiteMaskPixel;
+        }
+        if (!paintsBit[0] && !paintsBit[1])
+        {
+            return;
         }
     }
+
+    uchar *imageBits       = image.bits();
+    const uchar *maskBits  = maskPixels.constBits();
+    const int width        = image.width();
+    const int height       = image.height();
+    const int bandRows     = rowsPerBand(width);
+    ThreadPool::global().parallelFor(
+        (height + bandRows - 1) / bandRows,
+        [&](int band)
+        {
+            const int lastRow = std::min(height, (band + 1) * bandRows);
+            for (int y = band * bandRows; y < lastRow; ++y)
+            {
+                const uchar *maskRow = maskBits + y * maskPixels.bytesPerLine();
+                QRgb *imageRow       = reinterpret_cast<QRgb *>(imageBits + y * image.bytesPerLine());
+                if (bitmap)
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        if (paintsBit[maskRow[x >> 3] >> (x & 7) & 1])
+                        {
+                            imageRow[x] = ColorTransform::OverlayPixel;
+                        }
+                    }
+                    continue;
+                }
+                const QRgb *maskColors = reinterpret_cast<const QRgb *>(maskRow);
+                for (int x = 0; x < width; ++x)
+                {
+                    if (maskColors[x] == ColorTransform::WhiteMaskPixel)
+                    {
+                        imageRow[x] = ColorTransform::OverlayPixel;
+                    }
+                }
+            }
+        },
+        threadCount
+    );
+}
+
+int ImageSpaceConverter::rowsPerBand(int width)
+{
+    static constexpr int PixelsPerBand = 64 * 1024;
+    return std::max(1, PixelsPerBand / std::max(1, width));
 }
@@ -10,18 +10,32 @@
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHBoxLayout>
+#include <QImageReader>
+#include <QImageWriter>
 #include <QInputDialog>
 #include <QLabel>
 #include <QLineEdit>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QMouseEvent>
 #include <QPushButton>
+#include <QStatusBar>
 #include <QVBoxLayout>
+#include <QWheelEvent>
 #include <QCoreApplication>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <cmath>
+#include <cstring>
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
+MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), tileCache(TileCacheKilobytes)
 {
+    previewTimer = new QTimer(this);
+    previewTimer->setSingleShot(true);
+    previewTimer->setInterval(PreviewDelayMs);
+    connect(previewTimer, &QTimer::timeout, this, &MainWindow::updatePreview);
+
     // Create central widget and main layout
     QWidget *centralWidget  = new QWidget(this);
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
@@ -83,19 +97,49 @@ QHBoxLayout *MainWindow::createToolbarLayout()
     loadButton                      = new QPushButton("Load", this);
     saveButton                      = new QPushButton("Save", this);
     convertButton                   = new QPushButton("Convert", this);
+    cancelButton                    = new QPushButton("Cancel", this);
+    conversionProgress              = new QProgressBar(this);
     QCheckBox *showOutOfGamutButton = new QCheckBox("Show Out of Gamut", this);
+    QCheckBox *livePreviewButton    = new QCheckBox("Live Preview", this);
+    QCheckBox *recordTimingsButton  = new QCheckBox("Record Timings", this);
+    exportTimingsButton             = new QPushButton("Export Timings", this);
     showOutOfGamutButton->setChecked(showOutOfGamut);
+    livePreviewButton->setChecked(livePreview);
+    recordTimingsButton->setChecked(recordTimings);
+    exportTimingsButton->setEnabled(false);
+    conversionProgress->setRange(0, 100);
+    conversionProgress->setMaximumWidth(200);
+    setConversionRunning(false);
 
     toolbarLayout->addWidget(loadButton);
     toolbarLayout->addWidget(saveButton);
     toolbarLayout->addWidget(convertButton);
     toolbarLayout->addWidget(showOutOfGamutButton);
+    toolbarLayout->addWidget(livePreviewButton);
+    toolbarLayout->addWidget(recordTimingsButton);
+    toolbarLayout->addWidget(exportTimingsButton);
     toolbarLayout->addStretch();
+    toolbarLayout->addWidget(conversionProgress);
+    toolbarLayout->addWidget(cancelButton);
 
     connect(showOutOfGamutButton, &QCheckBox::toggled, this, &MainWindow::onShowOutOfGamutClicked);
+    connect(livePreviewButton, &QCheckBox::toggled, this, &MainWindow::onLivePreviewClicked);
+    connect(recordTimingsButton, &QCheckBox::toggled, this, &MainWindow::onRecordTimingsClicked);
+    connect(exportTimingsButton, &QPushButton::clicked, this, &MainWindow::onExportTimingsClicked);
     connect(loadButton, &QPushButton::clicked, this, &MainWindow::onLoadClicked);
     connect(saveButton, &QPushButton::clicked, this, &MainWindow::onSaveClicked);
     connect(convertButton, &QPushButton::clicked, this, &MainWindow::onConvertClicked);
+    connect(cancelButton, &QPushButton::clicked, this, &MainWindow::onCancelClicked);
+    connect(
+        this, &MainWindow::conversionProgressChanged, this,
+        [this](int generation, int percent)
+        {
+            if (generation == conversionGeneration)
+            {
+                conversionProgress->setValue(percent);
+            }
+        }
+    );
     return toolbarLayout;
 }
 
@@ -128,6 +172,7 @@ MainWindow::createSettingsGroup(const QString &title, ColorProfileControls &sett
         [this, &profile](const QString &text)
         {
             profile.gamma = text.toDouble();
+            settingsChanged();
         }
     );
 
@@ -157,6 +202,7 @@ MainWindow::createSettingsGroup(const QString &title, ColorProfileControls &sett
             [this, &value](const QString &text)
             {
                 value.x = text.toDouble();
+                settingsChanged();
             }
         );
         connect(
@@ -164,6 +210,7 @@ MainWindow::createSettingsGroup(const QString &title, ColorProfileControls &sett
             [this, &value](const QString &text)
             {
                 value.y = text.toDouble();
+                settingsChanged();
             }
         );
     };
@@ -216,13 +263,37 @@ void MainWindow::onLoadClicked()
 
     if (!filePath.isEmpty())
     {
-        QPixmap pixmap(filePath);
-        if (!pixmap.isNull())
+        // Decoding straight to the label size lets JPEG skip most of the DCT work
+        QImageReader reader(filePath);
+        const QSize fullSize = reader.size();
+        if (fullSize.isValid())
+        {
+            const QSize labelSize = sourceImageLabel->size();
+            if (fullSize.width() > labelSize.width() || fullSize.height() > labelSize.height())
+            {
+                reader.setScaledSize(fullSize.scaled(labelSize, Qt::KeepAspectRatio));
+            }
+        }
+
+        const QImage proxy = reader.read();
+        if (!proxy.isNull())
         {
-            sourceImage = pixmap;
-            sourceImageLabel->setPixmap(
-                sourceImage.scaled(sourceImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation)
-            );
+            // A save in flight already holds its own paths and may finish; anything else belongs to the old image
+            if (conversionPurpose != ConversionPurpose::Save || conversionWatcher == nullptr)
+            {
+                cancelConversion();
+            }
+            sourcePath      = filePath;
+            sourceProxy     = proxy;
+            convertedOutput = ConversionOutput();
+            sourcePyramid   = MipmapPyramid(sourceProxy);
+            targetPyramid   = MipmapPyramid();
+            zoom            = 1.0;
+            viewCenterX     = 0.5;
+            viewCenterY     = 0.5;
+            tileCache.clear();
+            renderViews();
+            schedulePreview();
         }
         else
         {
@@ -233,47 +304,412 @@ void MainWindow::onLoadClicked()
 
 void MainWindow::onSaveClicked()
 {
-    if (targetImage.isNull())
+    if (sourcePath.isEmpty())
     {
-        QMessageBox::warning(this, "Error", "No converted image to save.");
+        QMessageBox::warning(this, "Error", "No source image loaded.");
         return;
     }
 
     QString filePath = QFileDialog::getSaveFileName(this, "Save Image (Add full name with extension)", "", "Images (*.png *.jpg *.bmp)");
     if (!filePath.isEmpty())
     {
-        if (!targetImage.save(filePath))
-        {
-            QMessageBox::warning(this, "Error", "Failed to save image.");
-        }
+        savePath = filePath;
+        startConversion(ConversionPurpose::Save);
     }
 }
 
 void MainWindow::onConvertClicked()
 {
-    if (sourceImage.isNull())
+    if (sourceProxy.isNull())
     {
         QMessageBox::warning(this, "Error", "No source image loaded.");
         return;
     }
     currentConversionType = selectConversionType();
-    ConversionOutput output =
-        ImageSpaceConverter::convert(sourceImage.toImage(), sourceProfile, targetProfile, currentConversionType);
-    QImage &convertedImage = output.convertedImage;
+    tileCache.clear();
+    startConversion(ConversionPurpose::Convert);
+}
+
+void MainWindow::schedulePreview()
+{
+    // A pending preview reads the settings when it starts, so it already covers this edit
+    if (!livePreview || sourceProxy.isNull() || previewTimer->isActive())
+    {
+        return;
+    }
+    const qint64 sinceLast = lastPreviewStart.isValid() ? lastPreviewStart.elapsed() : PreviewDelayMs;
+    previewTimer->start(static_cast<int>(std::max<qint64>(0, PreviewDelayMs - sinceLast)));
+}
+
+void MainWindow::updatePreview()
+{
+    if (sourceProxy.isNull())
+    {
+        return;
+    }
+    // Edits made while saving must not cancel the save, retry once it is done
+    if (conversionWatcher != nullptr && conversionPurpose == ConversionPurpose::Save)
+    {
+        previewTimer->start(PreviewDelayMs);
+        return;
+    }
+    // Nothing changed since the last Convert, its full-resolution result is better than any preview
+    if (!convertedOutput.convertedImage.isNull())
+    {
+        return;
+    }
+    lastPreviewStart.start();
+    startConversion(
+        ConversionPurpose::Preview,
+        showsTiles() ? missingTiles(visibleRegion(sourcePyramid.size()), targetImageLabel->size()) : TileRequest()
+    );
+}
+
+void MainWindow::settingsChanged()
+{
+    // A save in flight keeps its own reference to the result
+    convertedOutput = ConversionOutput();
+    tileCache.clear();
+    // A preview in flight converts with the old settings, its tiles must not land in the cleared cache
+    if (conversionWatcher != nullptr && conversionPurpose == ConversionPurpose::Preview)
+    {
+        cancelConversion();
+    }
+    schedulePreview();
+}
+
+void MainWindow::renderViews()
+{
+    auto render = [this](const MipmapPyramid &pyramid, QLabel *label)
+    {
+        if (pyramid.isNull())
+        {
+            label->clear();
+            return;
+        }
+        label->setPixmap(QPixmap::fromImage(pyramid.render(visibleRegion(pyramid.size()), label->size())));
+    };
+    render(sourcePyramid, sourceImageLabel);
+
+    if (showsTiles())
+    {
+        const QImage tiles = renderTiles(visibleRegion(sourcePyramid.size()), targetImageLabel->size());
+        if (!tiles.isNull())
+        {
+            targetImageLabel->setPixmap(QPixmap::fromImage(tiles));
+            return;
+        }
+        // The next preview converts the missing tiles on the worker, the proxy stands in until then
+        schedulePreview();
+    }
+    render(targetPyramid, targetImageLabel);
+}
+
+bool MainWindow::showsTiles() const
+{
+    return livePreview && zoom > 1.0 && convertedOutput.convertedImage.isNull() && !sourcePyramid.isNull() &&
+           sourcePyramid.size() != sourceProxy.size();
+}
+
+QRect MainWindow::visibleRegion(const QSize &imageSize) const
+{
+    const QSize regionSize(
+        std::max(1, qRound(imageSize.width() / zoom)), std::max(1, qRound(imageSize.height() / zoom))
+    );
+    const int x = qBound(0, qRound(viewCenterX * imageSize.width() - regionSize.width() / 2.0),
+                         imageSize.width() - regionSize.width());
+    const int y = qBound(0, qRound(viewCenterY * imageSize.height() - regionSize.height() / 2.0),
+                         imageSize.height() - regionSize.height());
+    return QRect(QPoint(x, y), regionSize);
+}
+
+int MainWindow::tileLevel(const QRect &region, const QSize &size, QRect &levelRegion) const
+{
+    // Same level choice as MipmapPyramid::render, so the final scale stays below 2x
+    const QSize fitted = region.size().scaled(size, Qt::KeepAspectRatio);
+    int level          = 0;
+    while (level + 1 < sourcePyramid.levelCount() && (region.width() >> (level + 1)) >= fitted.width() &&
+           (region.height() >> (level + 1)) >= fitted.height())
+    {
+        ++level;
+    }
+    const QRect shifted(
+        region.x() >> level, region.y() >> level, std::max(1, region.width() >> level),
+        std::max(1, region.height() >> level)
+    );
+    levelRegion = shifted.intersected(sourcePyramid.level(level).rect());
+    return level;
+}
+
+quint64 MainWindow::tileKey(int level, int tileX, int tileY)
+{
+    return static_cast<quint64>(level) << 48 | static_cast<quint64>(tileY) << 24 | tileX;
+}
+
+QImage MainWindow::renderTiles(const QRect &region, const QSize &size) const
+{
+    QRect levelRegion;
+    const int level          = tileLevel(region, size, levelRegion);
+    const QImage &levelImage = sourcePyramid.level(level);
+
+    // Pyramid levels are RGB32 or ARGB32_Premultiplied, and their tiles convert to the same format
+    QImage composed(levelRegion.size(), levelImage.format());
+    for (int tileY = levelRegion.top() / TileSize; tileY <= levelRegion.bottom() / TileSize; ++tileY)
+    {
+        for (int tileX = levelRegion.left() / TileSize; tileX <= levelRegion.right() / TileSize; ++tileX)
+        {
+            const QImage *tile = tileCache.object(tileKey(level, tileX, tileY));
+            if (tile == nullptr)
+            {
+                return QImage();
+            }
+
+            const QRect tileRect =
+                QRect(tileX * TileSize, tileY * TileSize, TileSize, TileSize).intersected(levelImage.rect());
+            const QRect overlap = tileRect.intersected(levelRegion);
+            for (int y = overlap.top(); y <= overlap.bottom(); ++y)
+            {
+                std::memcpy(
+                    composed.scanLine(y - levelRegion.y()) + (overlap.x() - levelRegion.x()) * sizeof(QRgb),
+                    tile->constScanLine(y - tileRect.y()) + (overlap.x() - tileRect.x()) * sizeof(QRgb),
+                    overlap.width() * sizeof(QRgb)
+                );
+            }
+        }
+    }
+
+    const QSize fitted = region.size().scaled(size, Qt::KeepAspectRatio);
+    if (composed.size() == fitted)
+    {
+        return composed;
+    }
+    return composed.scaled(fitted, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+MainWindow::TileRequest MainWindow::missingTiles(const QRect &region, const QSize &size) const
+{
+    QRect levelRegion;
+    const int level = tileLevel(region, size, levelRegion);
+
+    TileRequest request;
+    request.levelImage = sourcePyramid.level(level);
+    for (int tileY = levelRegion.top() / TileSize; tileY <= levelRegion.bottom() / TileSize; ++tileY)
+    {
+        for (int tileX = levelRegion.left() / TileSize; tileX <= levelRegion.right() / TileSize; ++tileX)
+        {
+            const quint64 key = tileKey(level, tileX, tileY);
+            if (!tileCache.contains(key))
+            {
+                const QRect tileRect = QRect(tileX * TileSize, tileY * TileSize, TileSize, TileSize);
+                request.tiles.emplace_back(key, tileRect.intersected(request.levelImage.rect()));
+            }
+        }
+    }
+    return request;
+}
 
-    if (showOutOfGamut)
+void MainWindow::startConversion(ConversionPurpose purpose, const TileRequest &tiles)
+{
+    cancelConversion();
+
+    const int generation = ++conversionGeneration;
+    conversionCancelled  = std::make_shared<std::atomic_bool>(false);
+    conversionPurpose    = purpose;
+    auto lastPercent     = std::make_shared<std::atomic_int>(-1);
+
+    // The job owns its profiler, the options only point at it
+    const auto profiler = recordTimings ? std::make_shared<ConversionProfiler>() : nullptr;
+
+    // The overlay is painted into the pixels, so no job needs the mask itself
+    ConversionOptions options;
+    options.overlayOutOfGamut = showOutOfGamut;
+    options.outOfGamutMask    = false;
+    options.cancelled         = conversionCancelled.get();
+    options.bufferPool        = &bufferPool;
+    options.profiler          = profiler.get();
+    // Bands finish out of order, only ever move the bar forward and once per percent
+    options.progress = [this, generation, lastPercent](int rowsDone, int rowCount)
     {
-        ImageSpaceConverter::maskImage(convertedImage, output.outOfGamutMask);
+        const int percent = static_cast<int>(static_cast<qint64>(rowsDone) * 100 / rowCount);
+        int previous      = lastPercent->load();
+        while (percent > previous)
+        {
+            if (lastPercent->compare_exchange_weak(previous, percent))
+            {
+                emit conversionProgressChanged(generation, percent);
+                break;
+            }
+        }
+    };
+
+    conversionWatcher = new QFutureWatcher<ConversionJobResult>(this);
+    connect(conversionWatcher, &QFutureWatcherBase::finished, this, &MainWindow::onConversionFinished);
+    // The job keeps its own copies and a reference on the token, so superseding it frees nothing it still reads
+    conversionWatcher->setFuture(QtConcurrent::run(
+        [purpose, proxy = sourceProxy, converted = convertedOutput.convertedImage, inputPath = sourcePath,
+         outputPath = savePath, source = sourceProfile, target = targetProfile, type = currentConversionType, options,
+         token = conversionCancelled, profiler, tiles]()
+        {
+            ConversionJobResult result;
+            result.sourcePath = inputPath;
+            result.profile    = profiler;
+            if (purpose == ConversionPurpose::Preview)
+            {
+                result.output = ImageSpaceConverter::convert(proxy, source, target, type, options);
+                {
+                    ConversionProfiler::Scope scope(options.profiler, "pyramid");
+                    result.targetPyramid = MipmapPyramid(result.output.convertedImage, options.threadCount);
+                }
+
+                for (const auto &tile : tiles.tiles)
+                {
+                    if (token->load())
+                    {
+                        break;
+                    }
+                    const ConversionOutput output = ImageSpaceConverter::convert(
+                        tiles.levelImage, source, target, type, tile.second, 1.0, options
+                    );
+                    result.tiles.emplace_back(tile.first, output.convertedImage);
+                }
+                return result;
+            }
+
+            QImage convertedImage = converted;
+            if (purpose == ConversionPurpose::Convert || convertedImage.isNull())
+            {
+                QImageReader reader(inputPath);
+                QImage image;
+                {
+                    ConversionProfiler::Scope scope(options.profiler, "decode");
+                    image = reader.read();
+                }
+                if (image.isNull())
+                {
+                    result.error = reader.errorString();
+                    return result;
+                }
+                if (purpose == ConversionPurpose::Convert)
+                {
+                    result.output = ImageSpaceConverter::convert(image, source, target, type, options);
+                    if (token->load())
+                    {
+                        return result;
+                    }
+                    ConversionProfiler::Scope scope(options.profiler, "pyramid");
+                    result.sourcePyramid = MipmapPyramid(image, options.threadCount);
+                    result.targetPyramid = MipmapPyramid(result.output.convertedImage, options.threadCount);
+                    return result;
+                }
+
+                // Saving without a converted image only needs the pixels, which the decoded image can hold itself
+                ImageSpaceConverter::convertInPlace(image, source, target, type, options);
+                if (token->load())
+                {
+                    return result;
+                }
+                convertedImage = image;
+            }
+
+            QImageWriter writer(outputPath);
+            ConversionProfiler::Scope scope(options.profiler, "encode");
+            if (!writer.write(convertedImage))
+            {
+                result.error = writer.errorString();
+            }
+            return result;
+        }
+    ));
+    // Previews are quick enough that a progress bar would only flicker
+    setConversionRunning(purpose != ConversionPurpose::Preview);
+}
+
+void MainWindow::onCancelClicked()
+{
+    cancelConversion();
+    setConversionRunning(false);
+}
+
+void MainWindow::onConversionFinished()
+{
+    auto *watcher = static_cast<QFutureWatcher<ConversionJobResult> *>(sender());
+    watcher->deleteLater();
+    if (watcher != conversionWatcher)
+    {
+        return; // Superseded or cancelled
+    }
+    conversionWatcher = nullptr;
+    setConversionRunning(false);
+
+    ConversionJobResult result = watcher->result();
+    if (result.profile != nullptr)
+    {
+        lastProfile = result.profile;
+        exportTimingsButton->setEnabled(true);
+        statusBar()->showMessage(lastProfile->summaryText());
+    }
+    if (!result.error.isEmpty())
+    {
+        const QString action = conversionPurpose == ConversionPurpose::Save ? "save" : "convert";
+        QMessageBox::warning(this, "Error", "Failed to " + action + " image: " + result.error);
+        return;
     }
 
-    gamutMask = output.outOfGamutMask.scaled(sourceImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    convertedImage = convertedImage.scaled(sourceImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    switch (conversionPurpose)
+    {
+    case ConversionPurpose::Preview:
+        targetPyramid = result.targetPyramid;
+        for (const auto &tile : result.tiles)
+        {
+            if (!tile.second.isNull())
+            {
+                tileCache.insert(
+                    tile.first, new QImage(tile.second), std::max<qint64>(1, tile.second.sizeInBytes() / 1024)
+                );
+            }
+        }
+        break;
+    case ConversionPurpose::Convert:
+        // Only ever install the result for the image that is loaded now
+        if (result.sourcePath != sourcePath)
+        {
+            return;
+        }
+        convertedOutput = result.output;
+        sourcePyramid   = result.sourcePyramid;
+        targetPyramid   = result.targetPyramid;
+        break;
+    case ConversionPurpose::Save:
+        return;
+    }
+    renderViews();
+}
+
+void MainWindow::cancelConversion()
+{
+    if (conversionWatcher == nullptr)
+    {
+        return;
+    }
+    // The watcher still delivers finished() once the job has skipped its remaining bands, and deletes itself then
+    conversionCancelled->store(true);
+    conversionWatcher = nullptr;
+    ++conversionGeneration;
+}
 
-    targetImage = QPixmap::fromImage(convertedImage);
-    targetImageLabel->setPixmap(targetImage);
+void MainWindow::setConversionRunning(bool running)
+{
+    conversionProgress->setValue(0);
+    conversionProgress->setVisible(running);
+    cancelButton->setVisible(running);
 }
 
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow()
+{
+    // Jobs report progress through this window, so none may outlive it
+    cancelConversion();
+    QThreadPool::globalInstance()->waitForDone();
+}
 
 ConversionType MainWindow::selectConversionType()
 {
@@ -307,6 +743,96 @@ ConversionType MainWindow::selectConversionType()
     return currentConversionType;
 }
 
-void MainWindow::resizeEvent(QResizeEvent *event) { QWidget::resizeEvent(event); }
+void MainWindow::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    renderViews();
+}
+
+void MainWindow::wheelEvent(QWheelEvent *event)
+{
+    QWidget *target = childAt(event->position().toPoint());
+    if ((target != sourceImageLabel && target != targetImageLabel) || sourcePyramid.isNull())
+    {
+        QWidget::wheelEvent(event);
+        return;
+    }
+    // One notch is 120 units, each zooms by a quarter
+    zoom = qBound(1.0, zoom * std::pow(1.25, event->angleDelta().y() / 120.0), MaxZoom);
+    renderViews();
+    event->accept();
+}
+
+void MainWindow::mousePressEvent(QMouseEvent *event)
+{
+    QWidget *target = childAt(event->pos());
+    dragging        = event->button() == Qt::LeftButton && (target == sourceImageLabel || target == targetImageLabel);
+    dragPosition    = event->pos();
+    QWidget::mousePressEvent(event);
+}
+
+void MainWindow::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!dragging || zoom <= 1.0)
+    {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    // The visible region spans about one label, so a full label width of dragging moves it by one region width
+    const QPoint delta = event->pos() - dragPosition;
+    dragPosition       = event->pos();
+    const double half  = 0.5 / zoom;
+    viewCenterX = qBound(half, viewCenterX - delta.x() / (zoom * std::max(1, targetImageLabel->width())), 1.0 - half);
+    viewCenterY = qBound(half, viewCenterY - delta.y() / (zoom * std::max(1, targetImageLabel->height())), 1.0 - half);
+    renderViews();
+}
+
+void MainWindow::mouseReleaseEvent(QMouseEvent *event)
+{
+    dragging = false;
+    QWidget::mouseReleaseEvent(event);
+}
 
-void MainWindow::onShowOutOfGamutClicked() { showOutOfGamut = !showOutOfGamut; }
+void MainWindow::onShowOutOfGamutClicked()
+{
+    showOutOfGamut = !showOutOfGamut;
+    settingsChanged();
+}
+
+void MainWindow::onLivePreviewClicked()
+{
+    livePreview = !livePreview;
+    schedulePreview();
+}
+
+void MainWindow::onRecordTimingsClicked()
+{
+    recordTimings = !recordTimings;
+    if (!recordTimings)
+    {
+        statusBar()->clearMessage();
+    }
+}
+
+void MainWindow::onExportTimingsClicked()
+{
+    if (lastProfile == nullptr)
+    {
+        return;
+    }
+
+    const QString filePath = QFileDialog::getSaveFileName(
+        this, "Export Timings", "", "Chrome trace (*.trace.json);;Stage summary (*.json)"
+    );
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+    const auto format = filePath.endsWith(".trace.json") ? ConversionProfiler::ExportFormat::ChromeTrace
+                                                         : ConversionProfiler::ExportFormat::Summary;
+    QString error;
+    if (!lastProfile->save(filePath, format, &error))
+    {
+        QMessageBox::warning(this, "Error", "Failed to export timings: " + error);
+    }
+}
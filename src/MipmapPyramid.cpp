@@ -0,0 +1,110 @@
+#include "MipmapPyramid.h"
+#include "ImageSpaceConverter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+MipmapPyramid::MipmapPyramid(const QImage &image, int threadCount)
+{
+    if (image.isNull())
+    {
+        return;
+    }
+
+    // Premultiplied so that transparent pixels do not bleed their color into the averages
+    levels.append(image.convertToFormat(
+        image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32
+    ));
+    while (levels.last().width() > 1 || levels.last().height() > 1)
+    {
+        levels.append(halve(levels.last(), threadCount));
+    }
+}
+
+qint64 MipmapPyramid::sizeInBytes() const
+{
+    qint64 bytes = 0;
+    for (const QImage &level : levels)
+    {
+        bytes += level.sizeInBytes();
+    }
+    return bytes;
+}
+
+QImage MipmapPyramid::render(const QRect &region, const QSize &size) const
+{
+    const QRect clipped = region.intersected(QRect(QPoint(0, 0), this->size()));
+    if (isNull() || clipped.isEmpty() || size.isEmpty())
+    {
+        return QImage();
+    }
+
+    // Deepest level where the region still covers at least the output size
+    const QSize fitted = clipped.size().scaled(size, Qt::KeepAspectRatio);
+    int index          = 0;
+    while (index + 1 < levels.size() && (clipped.width() >> (index + 1)) >= fitted.width() &&
+           (clipped.height() >> (index + 1)) >= fitted.height())
+    {
+        ++index;
+    }
+
+    const QImage &source = levels[index];
+    const QRect levelRegion(
+        clipped.x() >> index, clipped.y() >> index, std::max(1, clipped.width() >> index),
+        std::max(1, clipped.height() >> index)
+    );
+    const QImage cropped = levelRegion == source.rect() ? source : source.copy(levelRegion);
+    if (cropped.size() == fitted)
+    {
+        return cropped;
+    }
+    return cropped.scaled(fitted, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+QImage MipmapPyramid::halve(const QImage &image, int threadCount)
+{
+    const int width  = image.width();
+    const int height = image.height();
+    QImage result(std::max(1, (width + 1) / 2), std::max(1, (height + 1) / 2), image.format());
+
+    // Raw pointers are taken up front, scanLine() on a shared image is not safe to call from several threads
+    const uchar *sourceBits = image.constBits();
+    uchar *resultBits       = result.bits();
+    const int resultWidth   = result.width();
+    const int resultHeight  = result.height();
+
+    const int bandRows = ImageSpaceConverter::rowsPerBand(resultWidth);
+    ThreadPool::global().parallelFor(
+        (resultHeight + bandRows - 1) / bandRows,
+        [&](int band)
+        {
+            const int lastRow = std::min(resultHeight, (band + 1) * bandRows);
+            for (int y = band * bandRows; y < lastRow; ++y)
+            {
+                // Odd sizes repeat the last row and column
+                const QRgb *top    = reinterpret_cast<const QRgb *>(sourceBits + 2 * y * image.bytesPerLine());
+                const QRgb *bottom = reinterpret_cast<const QRgb *>(
+                    sourceBits + std::min(2 * y + 1, height - 1) * image.bytesPerLine()
+                );
+                QRgb *target = reinterpret_cast<QRgb *>(resultBits + y * result.bytesPerLine());
+                for (int x = 0; x < resultWidth; ++x)
+                {
+                    const int left  = 2 * x;
+                    const int right = std::min(left + 1, width - 1);
+                    const QRgb a = top[left], b = top[right], c = bottom[left], d = bottom[right];
+
+                    // Rounded average of every byte of the four pixels
+                    QRgb average = 0;
+                    for (int shift = 0; shift < 32; shift += 8)
+                    {
+                        const uint sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) + ((c >> shift) & 0xff) +
+                                         ((d >> shift) & 0xff);
+                        average |= ((sum + 2) >> 2) << shift;
+                    }
+                    target[x] = average;
+                }
+            }
+        },
+        threadCount
+    );
+    return result;
+}
@@ -0,0 +1,91 @@
+#include "ProfileMatrices.h"
+#include "CommonProfiles.h"
+
+namespace
+{
+// The last CommonProfiles entry is the "Custom" placeholder
+constexpr int BuiltInCount = CommonProfiles::profilesCount - 1;
+constexpr int IntentCount  = ConversionTypes::typesCount;
+
+struct BuiltInMatrices
+{
+    Matrix3 rgbToXyz[BuiltInCount];
+    // [source][target][ConversionType]
+    Matrix3 conversions[BuiltInCount][BuiltInCount][IntentCount];
+};
+
+constexpr BuiltInMatrices buildTable()
+{
+    BuiltInMatrices table;
+    for (int source = 0; source < BuiltInCount; ++source)
+    {
+        table.rgbToXyz[source] = ProfileMatrices::rgbToXyz(CommonProfiles::profiles[source].profile);
+        for (int target = 0; target < BuiltInCount; ++target)
+        {
+            for (int intent = 0; intent < IntentCount; ++intent)
+            {
+                table.conversions[source][target][intent] = ProfileMatrices::conversion(
+                    CommonProfiles::profiles[source].profile, CommonProfiles::profiles[target].profile,
+                    ConversionTypes::types[intent].type
+                );
+            }
+        }
+    }
+    return table;
+}
+
+constexpr BuiltInMatrices builtInMatrices = buildTable();
+
+constexpr bool nearlyEqual(double a, double b) { return a - b < 1e-9 && b - a < 1e-9; }
+
+// Catches a broken table at compile time: RGB white maps to the profile white, and a profile converts to itself as
+// the identity under the colorimetric intents
+static_assert(nearlyEqual(builtInMatrices.rgbToXyz[0](1, 0) + builtInMatrices.rgbToXyz[0](1, 1) +
+                              builtInMatrices.rgbToXyz[0](1, 2), 1.0));
+static_assert(nearlyEqual(builtInMatrices.conversions[1][1][0](0, 0), 1.0));
+static_assert(nearlyEqual(builtInMatrices.conversions[4][4][1](2, 1), 0.0));
+
+static_assert(
+    static_cast<int>(ConversionTypes::types[IntentCount - 1].type) == IntentCount - 1,
+    "ConversionTypes::types must list the intents in enum order"
+);
+
+// Matrices do not depend on the gamma, so profiles differing only there share their entries
+bool samePrimaries(const ColorProfileSettings &a, const ColorProfileSettings &b)
+{
+    return a.white.x == b.white.x && a.white.y == b.white.y && a.red.x == b.red.x && a.red.y == b.red.y &&
+           a.green.x == b.green.x && a.green.y == b.green.y && a.blue.x == b.blue.x && a.blue.y == b.blue.y;
+}
+
+int primariesIndex(const ColorProfileSettings &profile)
+{
+    for (int i = 0; i < BuiltInCount; ++i)
+    {
+        if (samePrimaries(profile, CommonProfiles::profiles[i].profile))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+} // namespace
+
+Matrix3 ProfileMatrices::lookup(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType
+)
+{
+    const int source = primariesIndex(sourceProfile);
+    const int target = primariesIndex(targetProfile);
+    if (source >= 0 && target >= 0)
+    {
+        return builtInMatrices.conversions[source][target][static_cast<int>(conversionType)];
+    }
+    return conversion(sourceProfile, targetProfile, conversionType);
+}
+
+Matrix3 ProfileMatrices::lookupRgbToXyz(const ColorProfileSettings &profile)
+{
+    const int index = primariesIndex(profile);
+    return index >= 0 ? builtInMatrices.rgbToXyz[index] : rgbToXyz(profile);
+}
@@ -0,0 +1,112 @@
+#include "ReferenceConverter.h"
+#include "ColorTransform.h"
+#include "ImageSpaceConverter.h"
+#include "ThreadPool.h"
+#include <QMatrix4x4>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+int encode(double linear, double gamma)
+{
+    return qRound(std::pow(std::clamp(linear, 0.0, 1.0), 1.0 / gamma) * 255.0);
+}
+} // namespace
+
+ConversionOutput ReferenceConverter::convert(
+    const QImage &sourceImage, const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, int threadCount
+)
+{
+    const QImage source = sourceImage.convertToFormat(QImage::Format_RGB32);
+    QImage resultImage(source.size(), QImage::Format_RGB32);
+    QImage outOfGamutMask = ColorTransform::createMask(source.size());
+
+    const QMatrix4x4 sourceRGBtoXYZ = ImageSpaceConverter::computeRGBtoXYZMatrix(
+        sourceProfile.white, sourceProfile.red, sourceProfile.green, sourceProfile.blue
+    );
+    const QMatrix4x4 targetRGBtoXYZ = ImageSpaceConverter::computeRGBtoXYZMatrix(
+        targetProfile.white, targetProfile.red, targetProfile.green, targetProfile.blue
+    );
+    const QMatrix4x4 targetXYZtoRGB = targetRGBtoXYZ.inverted();
+
+    auto toTarget = [&](const QVector3D &linearRGB)
+    {
+        switch (conversionType)
+        {
+        case ConversionType::RelativeColorimetric:
+            return ImageSpaceConverter::transformColor(
+                ImageSpaceConverter::adjustWhitePoint(linearRGB, sourceProfile.white, targetProfile.white),
+                sourceRGBtoXYZ, targetXYZtoRGB
+            );
+        case ConversionType::Perceptual:
+            return targetXYZtoRGB.mapVector(ImageSpaceConverter::scaleToTargetGamut(
+                sourceRGBtoXYZ.mapVector(linearRGB), sourceProfile, targetProfile
+            ));
+        case ConversionType::AbsoluteColorimetric:
+        case ConversionType::Saturation:
+            break;
+        }
+        return ImageSpaceConverter::transformColor(linearRGB, sourceRGBtoXYZ, targetXYZtoRGB);
+    };
+
+    const uchar *sourceBits = source.constBits();
+    uchar *resultBits       = resultImage.bits();
+    uchar *maskBits         = outOfGamutMask.bits();
+    const int width         = source.width();
+
+    ThreadPool::global().parallelFor(
+        source.height(),
+        [&](int y)
+        {
+            const QRgb *sourceRow = reinterpret_cast<const QRgb *>(sourceBits + y * source.bytesPerLine());
+            QRgb *resultRow       = reinterpret_cast<QRgb *>(resultBits + y * resultImage.bytesPerLine());
+            uchar *maskRow        = maskBits + y * outOfGamutMask.bytesPerLine();
+            std::fill_n(maskRow, outOfGamutMask.bytesPerLine(), uchar(0));
+            for (int x = 0; x < width; ++x)
+            {
+                const QRgb pixel = sourceRow[x];
+                const QVector3D linearRGB(
+                    std::pow(qRed(pixel) / 255.0, sourceProfile.gamma),
+                    std::pow(qGreen(pixel) / 255.0, sourceProfile.gamma),
+                    std::pow(qBlue(pixel) / 255.0, sourceProfile.gamma)
+                );
+                const QVector3D targetRGB = toTarget(linearRGB);
+
+                if (ImageSpaceConverter::outOfGamut(targetRGB))
+                {
+                    maskRow[x >> 3] |= 1 << (x & 7);
+                }
+                QRgb converted = qRgb(
+                    encode(targetRGB.x(), targetProfile.gamma), encode(targetRGB.y(), targetProfile.gamma),
+                    encode(targetRGB.z(), targetProfile.gamma)
+                );
+
+                if (conversionType == ConversionType::Saturation)
+                {
+                    // Hue and lightness of the colorimetric result, saturation of the source
+                    float sourceH, sourceS, sourceL;
+                    ImageSpaceConverter::rgbToHsl(
+                        QVector3D(qRed(pixel), qGreen(pixel), qBlue(pixel)) / 255.0f, sourceH, sourceS, sourceL
+                    );
+                    float targetH, targetS, targetL;
+                    ImageSpaceConverter::rgbToHsl(
+                        QVector3D(qRed(converted), qGreen(converted), qBlue(converted)) / 255.0f, targetH, targetS,
+                        targetL
+                    );
+                    const QVector3D adjustedRgb = ImageSpaceConverter::hslToRgb(targetH, sourceS, targetL);
+                    converted                   = qRgb(
+                        qRound(qBound(0.0f, adjustedRgb.x(), 1.0f) * 255.0f),
+                        qRound(qBound(0.0f, adjustedRgb.y(), 1.0f) * 255.0f),
+                        qRound(qBound(0.0f, adjustedRgb.z(), 1.0f) * 255.0f)
+                    );
+                }
+                resultRow[x] = converted;
+            }
+        },
+        threadCount
+    );
+
+    return {resultImage, outOfGamutMask};
+}
@@ -0,0 +1,441 @@
+#include "StreamingConverter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QSaveFile>
+#include <algorithm>
+#include <cctype>
+#include <memory>
+
+namespace
+{
+// Hands out consecutive strips of an image as RGB32
+class StripSource
+{
+    public:
+    virtual ~StripSource() = default;
+
+    virtual QSize size() const                                        = 0;
+    virtual bool readStrip(int firstRow, int rowCount, QImage &strip) = 0;
+    virtual QString errorString() const                               = 0;
+    // Decoded pixels held between strips
+    virtual qint64 bufferedBytes() const { return 0; }
+};
+
+// Binary 8-bit PPM (P6), read one row at a time
+class PpmStripSource : public StripSource
+{
+    public:
+    bool open(const QString &path)
+    {
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            error = file.errorString();
+            return false;
+        }
+
+        QByteArray magic, width, height, maxValue;
+        if (!readToken(magic) || magic != "P6" || !readToken(width) || !readToken(height) || !readToken(maxValue))
+        {
+            error = "Not a binary PPM file";
+            return false;
+        }
+        if (maxValue.toInt() != 255)
+        {
+            error = "Only 8-bit PPM files can be streamed";
+            return false;
+        }
+
+        imageSize = QSize(width.toInt(), height.toInt());
+        rowBuffer.resize(static_cast<qsizetype>(imageSize.width()) * 3);
+        return !imageSize.isEmpty();
+    }
+
+    QSize size() const override { return imageSize; }
+
+    bool readStrip(int firstRow, int rowCount, QImage &strip) override
+    {
+        Q_UNUSED(firstRow) // Strips arrive in order, the file position already is at firstRow
+
+        strip = QImage(imageSize.width(), rowCount, QImage::Format_RGB32);
+        for (int y = 0; y < rowCount; ++y)
+        {
+            if (file.read(rowBuffer.data(), rowBuffer.size()) != rowBuffer.size())
+            {
+                error = "Unexpected end of PPM data";
+                return false;
+            }
+
+            const uchar *rgb = reinterpret_cast<const uchar *>(rowBuffer.constData());
+            QRgb *row        = reinterpret_cast<QRgb *>(strip.scanLine(y));
+            for (int x = 0; x < imageSize.width(); ++x)
+            {
+                row[x] = qRgb(rgb[3 * x], rgb[3 * x + 1], rgb[3 * x + 2]);
+            }
+        }
+        return true;
+    }
+
+    QString errorString() const override { return error; }
+
+    private:
+    QFile file;
+    QSize imageSize;
+    QByteArray rowBuffer;
+    QString error;
+
+    // Header tokens are separated by whitespace and may be interleaved with # comments
+    bool readToken(QByteArray &token)
+    {
+        token.clear();
+        char c;
+        while (file.getChar(&c))
+        {
+            if (c == '#')
+            {
+                while (file.getChar(&c) && c != '\n')
+                {
+                }
+            }
+            else if (!std::isspace(static_cast<uchar>(c)))
+            {
+                token.append(c);
+                break;
+            }
+        }
+        // Also consumes the single whitespace character that ends the header
+        while (file.getChar(&c) && !std::isspace(static_cast<uchar>(c)))
+        {
+            token.append(c);
+        }
+        return !token.isEmpty();
+    }
+};
+
+// Formats whose Qt plugin decodes clip rects. The decoders of sequential formats such as JPEG and PNG still run
+// from the top of the file down to the clip, so a clip read per strip would decode a quadratic number of rows.
+// Instead the image is read in at most ClipPasses bands of whole strips, one decode pass each, and strips are cut
+// from the current band: decoding costs about (ClipPasses + 1) / 2 full decodes whatever the strip count.
+class ClipRectStripSource : public StripSource
+{
+    public:
+    static constexpr int ClipPasses = 8;
+
+    ClipRectStripSource(const QString &path, const QSize &size, int stripRows) : path(path), imageSize(size)
+    {
+        const int passRows = (size.height() + ClipPasses - 1) / ClipPasses;
+        bandRows           = std::max(1, (passRows + stripRows - 1) / stripRows) * stripRows;
+    }
+
+    QSize size() const override { return imageSize; }
+
+    bool readStrip(int firstRow, int rowCount, QImage &strip) override
+    {
+        if (band.isNull() || firstRow < bandStart || firstRow + rowCount > bandStart + band.height())
+        {
+            QImageReader reader(path);
+            reader.setClipRect(
+                QRect(0, firstRow, imageSize.width(), std::min(bandRows, imageSize.height() - firstRow))
+            );
+            band = reader.read();
+            if (band.isNull())
+            {
+                error = reader.errorString();
+                return false;
+            }
+            band      = band.convertToFormat(QImage::Format_RGB32);
+            bandStart = firstRow;
+        }
+        strip = band.copy(0, firstRow - bandStart, imageSize.width(), rowCount);
+        return true;
+    }
+
+    QString errorString() const override { return error; }
+    qint64 bufferedBytes() const override { return band.sizeInBytes(); }
+
+    private:
+    QString path;
+    QSize imageSize;
+    int bandRows  = 0;
+    int bandStart = 0;
+    QImage band;
+    QString error;
+};
+
+// Fallback for formats that can only be decoded whole
+class FullImageStripSource : public StripSource
+{
+    public:
+    explicit FullImageStripSource(const QImage &image) : image(image.convertToFormat(QImage::Format_RGB32)) {}
+
+    QSize size() const override { return image.size(); }
+
+    bool readStrip(int firstRow, int rowCount, QImage &strip) override
+    {
+        strip = image.copy(0, firstRow, image.width(), rowCount);
+        return true;
+    }
+
+    QString errorString() const override { return {}; }
+
+    private:
+    QImage image;
+};
+
+// Writes rows as they come in; binary PPM/PGM or top-down uncompressed BMP
+class StripWriter
+{
+    public:
+    enum class Channels
+    {
+        Rgb,
+        Mask // Format_MonoLSB rows, written as black and white gray levels
+    };
+
+    bool open(const QString &path, const QSize &size, Channels channels)
+    {
+        this->channels = channels;
+        width          = size.width();
+        bmp            = QFileInfo(path).suffix().compare("bmp", Qt::CaseInsensitive) == 0;
+
+        const int bytesPerPixel = channels == Channels::Rgb ? 3 : 1;
+        rowBytes                = width * bytesPerPixel;
+        if (bmp)
+        {
+            rowBytes = (rowBytes + 3) & ~3;
+        }
+        rowBuffer = QByteArray(rowBytes, '\0');
+
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            return false;
+        }
+        return bmp ? writeBmpHeader(size, bytesPerPixel) : writePnmHeader(size);
+    }
+
+    bool writeRows(const QImage &rows)
+    {
+        uchar *out = reinterpret_cast<uchar *>(rowBuffer.data());
+        for (int y = 0; y < rows.height(); ++y)
+        {
+            const uchar *line = rows.constScanLine(y);
+            const QRgb *row   = reinterpret_cast<const QRgb *>(line);
+            for (int x = 0; x < width; ++x)
+            {
+                if (channels == Channels::Mask)
+                {
+                    out[x] = (line[x >> 3] >> (x & 7) & 1) != 0 ? 255 : 0;
+                }
+                else if (bmp)
+                {
+                    out[3 * x]     = static_cast<uchar>(qBlue(row[x]));
+                    out[3 * x + 1] = static_cast<uchar>(qGreen(row[x]));
+                    out[3 * x + 2] = static_cast<uchar>(qRed(row[x]));
+                }
+                else
+                {
+                    out[3 * x]     = static_cast<uchar>(qRed(row[x]));
+                    out[3 * x + 1] = static_cast<uchar>(qGreen(row[x]));
+                    out[3 * x + 2] = static_cast<uchar>(qBlue(row[x]));
+                }
+            }
+            if (file.write(rowBuffer) != rowBuffer.size())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool commit() { return file.commit(); }
+    QString errorString() const { return file.errorString(); }
+
+    private:
+    QSaveFile file;
+    Channels channels = Channels::Rgb;
+    bool bmp          = false;
+    int width         = 0;
+    int rowBytes      = 0;
+    QByteArray rowBuffer;
+
+    bool writePnmHeader(const QSize &size)
+    {
+        const QByteArray header = (channels == Channels::Rgb ? "P6\n" : "P5\n") + QByteArray::number(size.width()) +
+                                  " " + QByteArray::number(size.height()) + "\n255\n";
+        return file.write(header) == header.size();
+    }
+
+    bool writeBmpHeader(const QSize &size, int bytesPerPixel)
+    {
+        const quint32 paletteBytes = bytesPerPixel == 1 ? 256 * 4 : 0;
+        const quint32 dataOffset   = 14 + 40 + paletteBytes;
+        const quint32 imageBytes   = static_cast<quint32>(rowBytes) * static_cast<quint32>(size.height());
+
+        QByteArray header;
+        auto put16 = [&header](quint16 value)
+        {
+            header.append(static_cast<char>(value & 0xff));
+            header.append(static_cast<char>(value >> 8));
+        };
+        auto put32 = [&put16](quint32 value)
+        {
+            put16(static_cast<quint16>(value & 0xffff));
+            put16(static_cast<quint16>(value >> 16));
+        };
+
+        header.append("BM", 2);
+        put32(dataOffset + imageBytes);
+        put32(0);
+        put32(dataOffset);
+
+        put32(40);
+        put32(static_cast<quint32>(size.width()));
+        put32(static_cast<quint32>(-size.height())); // Negative height stores rows top-down
+        put16(1);
+        put16(static_cast<quint16>(bytesPerPixel * 8));
+        put32(0); // BI_RGB
+        put32(imageBytes);
+        put32(2835); // 72 DPI
+        put32(2835);
+        put32(bytesPerPixel == 1 ? 256 : 0);
+        put32(0);
+
+        for (quint32 i = 0; i < paletteBytes / 4; ++i)
+        {
+            put32(i | i << 8 | i << 16);
+        }
+        return file.write(header) == header.size();
+    }
+};
+
+bool isPpm(const QString &path)
+{
+    const QString suffix = QFileInfo(path).suffix();
+    return suffix.compare("ppm", Qt::CaseInsensitive) == 0 || suffix.compare("pnm", Qt::CaseInsensitive) == 0;
+}
+} // namespace
+
+StreamingConverter::StreamingConverter(const ColorTransform &transform, int stripRows, const ConversionOptions &options)
+    : transform(transform), stripRows(std::max(1, stripRows)), options(options)
+{
+}
+
+bool StreamingConverter::canWrite(const QString &path)
+{
+    const QString suffix = QFileInfo(path).suffix();
+    return isPpm(path) || suffix.compare("pgm", Qt::CaseInsensitive) == 0 ||
+           suffix.compare("bmp", Qt::CaseInsensitive) == 0;
+}
+
+bool StreamingConverter::convert(const QString &inputPath, const QString &outputPath, const QString &maskPath)
+{
+    lastError.clear();
+    fullDecode = false;
+    peakBytes  = 0;
+    size       = QSize();
+
+    if (!canWrite(outputPath) || (!maskPath.isEmpty() && !canWrite(maskPath)))
+    {
+        lastError = "Streamed output has to be a .ppm or .bmp file";
+        return false;
+    }
+
+    std::unique_ptr<StripSource> source;
+    QImageReader probe(inputPath);
+    if (isPpm(inputPath))
+    {
+        auto ppm = std::make_unique<PpmStripSource>();
+        if (!ppm->open(inputPath))
+        {
+            lastError = ppm->errorString();
+            return false;
+        }
+        source = std::move(ppm);
+    }
+    else if (probe.supportsOption(QImageIOHandler::ClipRect) && probe.size().isValid())
+    {
+        source = std::make_unique<ClipRectStripSource>(inputPath, probe.size(), stripRows);
+    }
+    else
+    {
+        const QImage image = probe.read();
+        if (image.isNull())
+        {
+            lastError = probe.errorString();
+            return false;
+        }
+        fullDecode = true;
+        source     = std::make_unique<FullImageStripSource>(image);
+    }
+
+    size = source->size();
+    StripWriter imageWriter;
+    StripWriter maskWriter;
+    if (!imageWriter.open(outputPath, size, StripWriter::Channels::Rgb))
+    {
+        lastError = imageWriter.errorString();
+        return false;
+    }
+    if (!maskPath.isEmpty() && !maskWriter.open(maskPath, size, StripWriter::Channels::Mask))
+    {
+        lastError = maskWriter.errorString();
+        return false;
+    }
+
+    // Progress is reported for the whole image rather than per strip
+    ConversionOptions stripOptions = options;
+    stripOptions.outOfGamutMask    = !maskPath.isEmpty();
+    int stripStart                 = 0;
+    if (options.progress)
+    {
+        stripOptions.progress = [&](int rowsDone, int)
+        {
+            options.progress(stripStart + rowsDone, size.height());
+        };
+    }
+
+    for (int y = 0; y < size.height(); y += stripRows)
+    {
+        if (options.cancelled != nullptr && options.cancelled->load(std::memory_order_relaxed))
+        {
+            lastError = "Conversion cancelled";
+            return false;
+        }
+
+        const int rowCount = std::min(stripRows, size.height() - y);
+        stripStart         = y;
+        QImage strip;
+        if (!source->readStrip(y, rowCount, strip))
+        {
+            lastError = source->errorString();
+            return false;
+        }
+
+        const ConversionOutput output = transform.convert(strip, stripOptions);
+        peakBytes = std::max(
+            peakBytes, static_cast<qint64>(source->bufferedBytes() + strip.sizeInBytes() +
+                                           output.convertedImage.sizeInBytes() + output.outOfGamutMask.sizeInBytes())
+        );
+
+        if (!imageWriter.writeRows(output.convertedImage))
+        {
+            lastError = imageWriter.errorString();
+            return false;
+        }
+        if (!maskPath.isEmpty() && !maskWriter.writeRows(output.outOfGamutMask))
+        {
+            lastError = maskWriter.errorString();
+            return false;
+        }
+    }
+
+    if (!imageWriter.commit() || (!maskPath.isEmpty() && !maskWriter.commit()))
+    {
+        lastError = "Failed to finish writing the output";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+
+struct ThreadPool::Job
+{
+    // Range of indices owned by one participant; others shrink it from the end when stealing
+    struct Range
+    {
+        std::mutex mutex;
+        int next = 0;
+        int end  = 0;
+    };
+
+    Job(int count, int participants, const std::function<void(int)> &task)
+        : task(task), ranges(participants), remaining(count), participants(participants)
+    {
+        for (int slot = 0; slot < participants; ++slot)
+        {
+            ranges[slot].next = static_cast<int>(static_cast<long long>(count) * slot / participants);
+            ranges[slot].end  = static_cast<int>(static_cast<long long>(count) * (slot + 1) / participants);
+        }
+    }
+
+    const std::function<void(int)> &task;
+    std::vector<Range> ranges;
+    std::atomic<int> remaining;
+    std::atomic<int> joined{1}; // Slot 0 belongs to the calling thread
+    const int participants;
+
+    std::mutex doneMutex;
+    std::condition_variable done;
+
+    bool takeOwn(int slot, int &index)
+    {
+        Range &range = ranges[slot];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.next >= range.end)
+        {
+            return false;
+        }
+        index = range.next++;
+        return true;
+    }
+
+    bool steal(int slot)
+    {
+        for (int offset = 1; offset < participants; ++offset)
+        {
+            Range &victim = ranges[(slot + offset) % participants];
+            int begin, end;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                const int available = victim.end - victim.next;
+                if (available <= 0)
+                {
+                    continue;
+                }
+                end        = victim.end;
+                begin      = victim.end - (available + 1) / 2;
+                victim.end = begin;
+            }
+
+            Range &own = ranges[slot];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.next = begin;
+            own.end  = end;
+            return true;
+        }
+        return false;
+    }
+
+    bool hasWork()
+    {
+        for (Range &range : ranges)
+        {
+            std::lock_guard<std::mutex> lock(range.mutex);
+            if (range.next < range.end)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    for (int i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsAvailable.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &task, int maxThreads)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    int participants = maxThreads > 0 ? std::min(maxThreads, threadCount()) : threadCount();
+    participants     = std::min(participants, count);
+    if (participants <= 1)
+    {
+        for (int index = 0; index < count; ++index)
+        {
+            task(index);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>(count, participants, task);
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        activeJobs.push_back(job);
+    }
+    jobsAvailable.notify_all();
+
+    runJob(*job, 0);
+    retireJob(job);
+
+    std::unique_lock<std::mutex> lock(job->doneMutex);
+    job->done.wait(
+        lock,
+        [&job]
+        {
+            return job->remaining.load() == 0;
+        }
+    );
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        int slot                 = 0;
+        std::shared_ptr<Job> job = claimJob(slot);
+        if (!job)
+        {
+            return;
+        }
+        runJob(*job, slot);
+        retireJob(job);
+    }
+}
+
+std::shared_ptr<ThreadPool::Job> ThreadPool::claimJob(int &slot)
+{
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    while (true)
+    {
+        if (stopping)
+        {
+            return nullptr;
+        }
+
+        for (const std::shared_ptr<Job> &job : activeJobs)
+        {
+            slot = job->joined.fetch_add(1);
+            if (slot < job->participants)
+            {
+                return job;
+            }
+        }
+
+        // Every active job already has all the participants it asked for
+        jobsAvailable.wait(lock);
+    }
+}
+
+void ThreadPool::retireJob(const std::shared_ptr<Job> &job)
+{
+    // Once nothing is left to take, stop handing the job to idle workers
+    if (!job->hasWork())
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        activeJobs.erase(std::remove(activeJobs.begin(), activeJobs.end(), job), activeJobs.end());
+    }
+}
+
+void ThreadPool::runJob(Job &job, int slot)
+{
+    int index = 0;
+    while (job.takeOwn(slot, index) || (job.steal(slot) && job.takeOwn(slot, index)))
+    {
+        job.task(index);
+        if (job.remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(job.doneMutex);
+            job.done.notify_all();
+        }
+    }
+}
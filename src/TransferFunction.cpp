@@ -0,0 +1,60 @@
+#include "TransferFunction.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+TransferFunction::TransferFunction(double gamma) : gammaValue(gamma)
+{
+    for (int i = 0; i < DecodeSize; ++i)
+    {
+        decodeTable[i] = static_cast<float>(std::pow(i / double(DecodeSize - 1), gamma));
+    }
+
+    // Encoded codes as a function of the root are root^(2^roots / gamma); keeping that exponent at 2/3 or more
+    // bounds the step between the first entries near black to well under a code
+    while (encodeRootCount < MaxEncodeRoots && 1.5 * (1 << encodeRootCount) < gamma)
+    {
+        ++encodeRootCount;
+    }
+    // Entry i holds the encoded value of linear = (i / (EncodeSize - 1))^(2^roots)
+    for (int i = 0; i < EncodeSize; ++i)
+    {
+        double root    = i / double(EncodeSize - 1);
+        double encoded = std::pow(root, (1 << encodeRootCount) / gamma);
+        encodeTable[i] = static_cast<uchar>(std::lround(std::clamp(encoded, 0.0, 1.0) * 255.0));
+    }
+    std::fill(encodeTable.begin() + EncodeSize, encodeTable.end(), encodeTable[EncodeSize - 1]);
+
+    for (int i = 0; i <= WideDecodeSize; ++i)
+    {
+        wideDecodeTable[i] = static_cast<float>(std::pow(i / double(WideDecodeSize), gamma));
+    }
+    for (int i = 0; i <= WideEncodeSize; ++i)
+    {
+        double root        = i / double(WideEncodeSize);
+        wideEncodeTable[i] = static_cast<float>(std::pow(root * root, 1.0 / gamma));
+    }
+}
+
+std::shared_ptr<const TransferFunction> TransferFunction::forGamma(double gamma)
+{
+    static std::mutex cacheMutex;
+    static std::map<double, std::weak_ptr<const TransferFunction>> cache;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (auto cached = cache[gamma].lock())
+    {
+        return cached;
+    }
+
+    // Gamma fields are edited live in the UI, so drop tables nobody uses anymore
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        it = it->second.expired() ? cache.erase(it) : std::next(it);
+    }
+
+    auto transferFunction = std::make_shared<const TransferFunction>(gamma);
+    cache[gamma]          = transferFunction;
+    return transferFunction;
+}
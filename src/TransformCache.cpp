@@ -0,0 +1,210 @@
+#include "TransformCache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// Bumped whenever plans or LUTs would come out differently for the same inputs, which orphans the old files
+constexpr char KeyVersion[]         = "ImageProfileConverter transform cache 1";
+constexpr char PlanMagic[8]         = {'I', 'P', 'C', 'P', 'L', 'A', 'N', '1'};
+constexpr qint64 PlanFileSize       = sizeof(PlanMagic) + 9 * sizeof(float);
+constexpr qint64 MemoryLutKilobytes = 256 * 1024;
+
+void appendDouble(QByteArray &bytes, double value)
+{
+    // +0.0 and -0.0 name the same profile
+    value = value == 0.0 ? 0.0 : value;
+    uchar buffer[sizeof(double)];
+    qToLittleEndian<double>(value, buffer);
+    bytes.append(reinterpret_cast<const char *>(buffer), sizeof(buffer));
+}
+
+void appendProfile(QByteArray &bytes, const ColorProfileSettings &profile)
+{
+    for (double value :
+         {profile.gamma, profile.white.x, profile.white.y, profile.red.x, profile.red.y, profile.green.x,
+          profile.green.y, profile.blue.x, profile.blue.y})
+    {
+        appendDouble(bytes, value);
+    }
+}
+} // namespace
+
+TransformCache::TransformCache(const QString &directory, int memoryEntries)
+    : transforms(memoryEntries), luts(MemoryLutKilobytes)
+{
+    setDirectory(directory);
+}
+
+TransformCache &TransformCache::global()
+{
+    static TransformCache cache;
+    return cache;
+}
+
+void TransformCache::setDirectory(const QString &directory)
+{
+    if (!directory.isEmpty())
+    {
+        QDir().mkpath(directory);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    cacheDirectory = directory;
+}
+
+QString TransformCache::directory() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cacheDirectory;
+}
+
+QByteArray TransformCache::key(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, int gridSize
+)
+{
+    QByteArray bytes(KeyVersion);
+    appendProfile(bytes, sourceProfile);
+    appendProfile(bytes, targetProfile);
+    appendDouble(bytes, static_cast<int>(conversionType));
+    appendDouble(bytes, gridSize);
+    return QCryptographicHash::hash(bytes, QCryptographicHash::Sha256).toHex();
+}
+
+QString TransformCache::filePath(const QByteArray &key, const char *suffix) const
+{
+    return cacheDirectory.isEmpty() ? QString()
+                                    : QDir(cacheDirectory).filePath(QString::fromLatin1(key) + "." + suffix);
+}
+
+ColorTransform TransformCache::transform(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType
+)
+{
+    return findTransform(sourceProfile, targetProfile, conversionType, &counters);
+}
+
+ColorTransform TransformCache::findTransform(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, Statistics *counted
+)
+{
+    const QByteArray planKey = key(sourceProfile, targetProfile, conversionType);
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (const ColorTransform *cached = transforms.object(planKey))
+        {
+            if (counted != nullptr)
+            {
+                ++counted->memoryHits;
+            }
+            return *cached;
+        }
+        path = filePath(planKey, "plan");
+    }
+
+    // Files and plans are built without the lock; two threads missing at once both build, with the same result
+    bool fromDisk = false;
+    QMatrix4x4 matrix;
+    QFile file(path);
+    if (!path.isEmpty() && file.open(QIODevice::ReadOnly))
+    {
+        const QByteArray bytes = file.read(PlanFileSize);
+        if (bytes.size() == PlanFileSize && std::memcmp(bytes.constData(), PlanMagic, sizeof(PlanMagic)) == 0)
+        {
+            const uchar *values = reinterpret_cast<const uchar *>(bytes.constData()) + sizeof(PlanMagic);
+            for (int i = 0; i < 9; ++i)
+            {
+                matrix(i / 3, i % 3) = qFromLittleEndian<float>(values + i * sizeof(float));
+            }
+            fromDisk = true;
+        }
+    }
+
+    if (!fromDisk)
+    {
+        matrix = ColorTransform::computeMatrix(sourceProfile, targetProfile, conversionType);
+        if (!path.isEmpty())
+        {
+            QByteArray bytes(PlanMagic, sizeof(PlanMagic));
+            for (int i = 0; i < 9; ++i)
+            {
+                uchar buffer[sizeof(float)];
+                qToLittleEndian<float>(matrix(i / 3, i % 3), buffer);
+                bytes.append(reinterpret_cast<const char *>(buffer), sizeof(buffer));
+            }
+            // The cache is best effort, a directory that cannot be written only costs the next run a rebuild
+            QSaveFile saveFile(path);
+            if (saveFile.open(QIODevice::WriteOnly) && saveFile.write(bytes) == bytes.size())
+            {
+                saveFile.commit();
+            }
+        }
+    }
+
+    const ColorTransform transform(sourceProfile, targetProfile, conversionType, matrix);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (counted != nullptr)
+    {
+        ++(fromDisk ? counted->diskHits : counted->misses);
+    }
+    transforms.insert(planKey, new ColorTransform(transform));
+    return transform;
+}
+
+ColorLut3D TransformCache::lut(
+    const ColorProfileSettings &sourceProfile, const ColorProfileSettings &targetProfile,
+    ConversionType conversionType, int gridSize
+)
+{
+    // Sizes ColorLut3D would clamp must share the key and file of the size it bakes
+    gridSize                = std::clamp(gridSize, ColorLut3D::MinGrid, ColorLut3D::MaxGrid);
+    const QByteArray lutKey = key(sourceProfile, targetProfile, conversionType, gridSize);
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (const ColorLut3D *cached = luts.object(lutKey))
+        {
+            ++counters.memoryHits;
+            return *cached;
+        }
+        path = filePath(lutKey, ColorLut3D::BinarySuffix);
+    }
+
+    ColorLut3D lut      = path.isEmpty() ? ColorLut3D() : ColorLut3D::mapBinary(path);
+    const bool fromDisk = !lut.isNull() && lut.gridSize() == gridSize;
+    if (!fromDisk)
+    {
+        lut = ColorLut3D(findTransform(sourceProfile, targetProfile, conversionType, nullptr), gridSize);
+        if (!path.isEmpty())
+        {
+            lut.writeBinary(path);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++(fromDisk ? counters.diskHits : counters.misses);
+    luts.insert(lutKey, new ColorLut3D(lut), std::max<qint64>(1, lut.sizeInBytes() / 1024));
+    return lut;
+}
+
+TransformCache::Statistics TransformCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void TransformCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    transforms.clear();
+    luts.clear();
+    counters = Statistics();
+}
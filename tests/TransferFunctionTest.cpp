@@ -0,0 +1,40 @@
+#include "TransferFunction.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// The 8-bit encode table has to stay within one code of the exact curve for every gamma the settings accept,
+// near black included, where the curve is steepest
+int main()
+{
+    int failures = 0;
+    for (int step = 0; step <= 90; ++step)
+    {
+        const double gamma = 1.0 + step * 0.1;
+        const TransferFunction transferFunction(gamma);
+
+        int worst          = 0;
+        float worstLinear  = 0.0f;
+        constexpr int Size = 1 << 20;
+        for (int i = 0; i <= Size; ++i)
+        {
+            // Squared, so the samples get denser towards black like the table entries do
+            const float root   = i / float(Size);
+            const float linear = root * root;
+            const int exact    = static_cast<int>(std::lround(std::pow(double(linear), 1.0 / gamma) * 255.0));
+            const int error    = std::abs(transferFunction.encode(linear) - exact);
+            if (error > worst)
+            {
+                worst       = error;
+                worstLinear = linear;
+            }
+        }
+        if (worst > 1)
+        {
+            std::printf("gamma %.1f: encode off by %d codes at linear %g\n", gamma, worst, worstLinear);
+            ++failures;
+        }
+    }
+    std::printf("%d of 91 gammas off by more than one code\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}